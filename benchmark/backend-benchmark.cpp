@@ -0,0 +1,59 @@
+
+#include "stdinc.hpp"
+
+#include "greeting-grpc/greeting-client.h"
+#include "greeting-grpc/greeting-server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <latch>
+
+/**
+ * Head to head: `SayHello` round trips with the server on `state.range(0)` and the client
+ * on `state.range(1)` (each a `RpcBackend`), with `state.range(2)` concurrent callers.
+ *
+ * The completion queue backend polls on the execution context's threads; the callback
+ * backend runs on grpc's own event engine, and only hops onto the context to complete.
+ */
+namespace
+{
+
+void BM_SayHelloBackend(benchmark::State& state)
+{
+   const auto server_backend = static_cast<sgrpc::RpcBackend>(state.range(0));
+   const auto client_backend = static_cast<sgrpc::RpcBackend>(state.range(1));
+   const auto concurrency    = static_cast<std::size_t>(state.range(2));
+
+   sgrpc::ExecutionContext context{4, 2};
+   auto server = Greeting::ServerContainer::build(
+       context,
+       std::make_shared<Greeting::Server>(),
+       sgrpc::ServerOptions{.number_work_queues = 2, .backend = server_backend});
+   context.run();
+
+   auto channel = grpc::CreateChannel(fmt::format("localhost:{}", server.port()),
+                                      grpc::InsecureChannelCredentials());
+   Greeting::Client client{context, channel, Greeting::ClientOptions{.backend = client_backend}};
+
+   for(auto _ : state) {
+      std::latch done{static_cast<std::ptrdiff_t>(concurrency)};
+      for(std::size_t i = 0; i < concurrency; ++i)
+         stdexec::start_detached(client.say_hello("Tritarch")
+                                 | stdexec::then([&done](std::string) { done.count_down(); })
+                                 | stdexec::upon_error([&done](auto&&) { done.count_down(); }));
+      done.wait();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * concurrency));
+}
+
+} // namespace
+
+BENCHMARK(BM_SayHelloBackend)
+    ->ArgsProduct({{static_cast<int64_t>(sgrpc::RpcBackend::CompletionQueue),
+                    static_cast<int64_t>(sgrpc::RpcBackend::Callback)},
+                   {static_cast<int64_t>(sgrpc::RpcBackend::CompletionQueue),
+                    static_cast<int64_t>(sgrpc::RpcBackend::Callback)},
+                   {1, 64}})
+    ->ArgNames({"server", "client", "callers"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,149 @@
+
+#include "stdinc.hpp"
+
+#include "greeting-grpc/greeting-client.h"
+
+#include <protos/helloworld.sgrpc.pb.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <latch>
+#include <mutex>
+#include <random>
+#include <thread>
+
+/**
+ * `SayHello` against three local replicas on ephemeral ports, where the last replica is
+ * `state.range(1)` (0: slow, answering after 2ms; 1: dead, refusing connections). Calls are
+ * spread by `state.range(0)` (0: uniformly at random; 1: an `EndpointBalancer`), with 32
+ * concurrent callers.
+ *
+ * Reports the p50/p99 round trip, the share of calls served by the last replica, and the
+ * share of calls that failed. The balancer should keep the p99 (and failures) down, by
+ * sending the last replica less traffic.
+ */
+namespace
+{
+
+constexpr std::size_t k_number_replicas = 3;
+constexpr std::size_t k_number_callers  = 32;
+
+struct Replica
+{
+   std::chrono::microseconds delay{0};
+   std::atomic<uint64_t> calls{0};
+
+   helloworld::HelloReply say_hello(const grpc::ServerContextBase&,
+                                    const helloworld::HelloRequest& request)
+   {
+      calls.fetch_add(1, std::memory_order_relaxed);
+      if(delay.count() > 0) std::this_thread::sleep_for(delay);
+      helloworld::HelloReply reply;
+      reply.set_message(request.name());
+      return reply;
+   }
+};
+
+struct Cluster
+{
+   // Each replica has its own context, so that a slow replica does not stall the others
+   std::vector<std::unique_ptr<sgrpc::ExecutionContext>> contexts;
+   std::vector<std::shared_ptr<Replica>> replicas;
+   std::vector<std::string> addresses;
+
+   explicit Cluster(bool is_last_dead)
+   {
+      using Wiring = helloworld::GreeterSgrpc::Server<Replica>;
+      const auto number_live = is_last_dead ? k_number_replicas - 1 : k_number_replicas;
+      for(std::size_t i = 0; i < number_live; ++i) {
+         auto& context = *contexts.emplace_back(std::make_unique<sgrpc::ExecutionContext>(2, 1));
+         auto& replica = replicas.emplace_back(std::make_shared<Replica>());
+         if(i + 1 == k_number_replicas) replica->delay = std::chrono::milliseconds{2};
+         auto container = Wiring::make(context, replica);
+         addresses.push_back(container->address());
+         context.run();
+      }
+      if(is_last_dead) addresses.push_back("localhost:1"); // Nothing listens on port 1
+   }
+
+   double last_share() const
+   {
+      uint64_t total = 0;
+      for(const auto& replica : replicas) total += replica->calls.load();
+      const auto last = replicas.size() == k_number_replicas ? replicas.back()->calls.load() : 0;
+      return total == 0 ? 0.0 : static_cast<double>(last) / static_cast<double>(total);
+   }
+};
+
+void BM_SayHelloBalanced(benchmark::State& state)
+{
+   const bool is_balanced  = state.range(0) == 1;
+   const bool is_last_dead = state.range(1) == 1;
+
+   Cluster cluster{is_last_dead};
+   sgrpc::ExecutionContext context{4, 2};
+   context.run();
+
+   // Random spreading: one client per replica; balancing: one client over all of them
+   std::vector<std::unique_ptr<Greeting::Client>> clients;
+   if(is_balanced) {
+      clients.push_back(std::make_unique<Greeting::Client>(context, cluster.addresses));
+   } else {
+      for(const auto& address : cluster.addresses)
+         clients.push_back(
+             std::make_unique<Greeting::Client>(context, sgrpc::make_channel(address)));
+   }
+
+   std::mutex padlock;
+   std::vector<double> latencies_us;
+   uint64_t failures = 0;
+   std::minstd_rand generator{42};
+
+   for(auto _ : state) {
+      std::latch done{static_cast<std::ptrdiff_t>(k_number_callers)};
+      for(std::size_t i = 0; i < k_number_callers; ++i) {
+         auto& client = *clients[std::uniform_int_distribution<std::size_t>{
+             0, clients.size() - 1}(generator)];
+         const auto started = std::chrono::steady_clock::now();
+         auto record        = [&, started](bool is_ok) {
+            const std::chrono::duration<double, std::micro> elapsed
+                = std::chrono::steady_clock::now() - started;
+            {
+               std::lock_guard lock{padlock};
+               latencies_us.push_back(elapsed.count());
+               if(!is_ok) ++failures;
+            }
+            done.count_down();
+         };
+         stdexec::start_detached(client.say_hello("Tritarch")
+                                 | stdexec::then([record](std::string) { record(true); })
+                                 | stdexec::upon_error([record](auto&&) { record(false); }));
+      }
+      done.wait();
+   }
+
+   std::sort(begin(latencies_us), end(latencies_us));
+   auto quantile = [&](double q) {
+      return latencies_us.empty()
+                 ? 0.0
+                 : latencies_us[static_cast<std::size_t>(
+                     q * static_cast<double>(latencies_us.size() - 1))];
+   };
+   state.counters["p50_us"]     = quantile(0.50);
+   state.counters["p99_us"]     = quantile(0.99);
+   state.counters["last_share"] = cluster.last_share();
+   state.counters["failed"]
+       = latencies_us.empty()
+             ? 0.0
+             : static_cast<double>(failures) / static_cast<double>(latencies_us.size());
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * k_number_callers));
+}
+
+} // namespace
+
+BENCHMARK(BM_SayHelloBalanced)
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->ArgNames({"balanced", "last_dead"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,103 @@
+
+#include "stdinc.hpp"
+
+#include "greeting-grpc/greeting-server.h"
+
+#include "sgrpc/sgrpc.hpp"
+
+#include <protos/helloworld.grpc.pb.h>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+/**
+ * Round trips of a (compressible) payload of `state.range(0)` bytes, with request and
+ * response compressed by `state.range(1)` (a `CompressionAlgorithm`).
+ *
+ * Compare `bytes_per_second` (throughput) and `cpu` (process CPU, client + server) across
+ * payload sizes to choose compression per method.
+ */
+namespace
+{
+using Service = helloworld::Greeter::AsyncService;
+using Stub    = helloworld::Greeter::Stub;
+
+std::string make_payload(std::size_t size)
+{
+   // Text-like: a small vocabulary, so that it compresses somewhat realistically
+   static constexpr std::string_view k_words[]
+       = {"order ", "id=", "12345 ", "status ", "shipped ", "customer ", "\"name\": ", "true, "};
+   std::minstd_rand generator{42};
+   std::uniform_int_distribution<std::size_t> distribution{0, std::size(k_words) - 1};
+   std::string payload;
+   payload.reserve(size + 16);
+   while(payload.size() < size) payload += k_words[distribution(generator)];
+   payload.resize(size);
+   return payload;
+}
+
+void BM_SayHelloCompression(benchmark::State& state)
+{
+   const auto payload_size = static_cast<std::size_t>(state.range(0));
+   const auto algorithm    = static_cast<sgrpc::CompressionAlgorithm>(state.range(1));
+   const auto compression  = algorithm == sgrpc::CompressionAlgorithm::None
+                                 ? std::optional<sgrpc::CompressionOptions>{}
+                                 : sgrpc::CompressionOptions{.algorithm = algorithm};
+
+   sgrpc::ExecutionContext context{2, 1};
+   auto container = sgrpc::GenericServerContainer<Service, Greeting::Server>::make(
+       context,
+       std::make_shared<Greeting::Server>(),
+       [compression](Greeting::Server& server,
+                     Service& service,
+                     sgrpc::Scheduler scheduler,
+                     grpc::ServerCompletionQueue& cq) {
+          new sgrpc::ServerRpcHandler<helloworld::HelloRequest, helloworld::HelloReply>(
+              scheduler,
+              sgrpc::bind_rpc(service, &Service::RequestSayHello),
+              sgrpc::bind_logic(server, &Greeting::Server::say_hello),
+              cq,
+              sgrpc::ServerMethodOptions{.compression = compression});
+       },
+       sgrpc::ServerOptions{});
+   context.run();
+
+   auto channel = grpc::CreateChannel(fmt::format("localhost:{}", container->port()),
+                                      grpc::InsecureChannelCredentials());
+   auto grpc_stub = helloworld::Greeter::NewStub(channel);
+   sgrpc::ClientRpcStub<Stub, helloworld::HelloRequest, helloworld::HelloReply> stub{
+       *grpc_stub, &Stub::PrepareAsyncSayHello};
+   stub.set_call_options(sgrpc::ClientCallOptions{.compression = compression});
+
+   struct ConvertResult
+   {
+      std::size_t operator()(helloworld::HelloReply&& reply) { return reply.message().size(); }
+   };
+
+   helloworld::HelloRequest request;
+   request.set_name(make_payload(payload_size));
+
+   for(auto _ : state) {
+      auto sender = stub.call_inline<std::size_t, ConvertResult>(context, request);
+      auto [size] = stdexec::sync_wait(std::move(sender)).value();
+      benchmark::DoNotOptimize(size);
+   }
+   state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload_size * 2));
+
+   container->grpc_server().Shutdown();
+   container->grpc_server().Wait();
+}
+
+} // namespace
+
+BENCHMARK(BM_SayHelloCompression)
+    ->ArgsProduct({{1 << 10, 1 << 14, 1 << 17, 1 << 20},
+                   {static_cast<int64_t>(sgrpc::CompressionAlgorithm::None),
+                    static_cast<int64_t>(sgrpc::CompressionAlgorithm::Deflate),
+                    static_cast<int64_t>(sgrpc::CompressionAlgorithm::Gzip)}})
+    ->ArgNames({"bytes", "algorithm"})
+    ->MeasureProcessCPUTime()
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
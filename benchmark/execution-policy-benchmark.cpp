@@ -0,0 +1,115 @@
+
+#include "stdinc.hpp"
+
+#include "sgrpc/sgrpc.hpp"
+
+#include <protos/helloworld.grpc.pb.h>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <latch>
+#include <string>
+
+/**
+ * Round-trip latency of a method whose logic takes `state.range(1)` microseconds, under
+ * each `ExecutionPolicy` (`state.range(0)`), with `state.range(2)` concurrent callers.
+ *
+ * Inline avoids a thread hop, but blocks completion queue polling for the duration of the
+ * logic; offloading to a separate context keeps the server's own threads free for polling.
+ */
+namespace
+{
+using Service = helloworld::Greeter::AsyncService;
+using Stub    = helloworld::Greeter::Stub;
+
+enum class Policy : int64_t { Inline, Offload, OffloadToPool };
+
+struct BusyServer
+{
+   std::chrono::microseconds work{0};
+
+   helloworld::HelloReply say_hello(const grpc::ServerContextBase&,
+                                    const helloworld::HelloRequest& request)
+   {
+      const auto until = std::chrono::steady_clock::now() + work;
+      while(std::chrono::steady_clock::now() < until) {} // Simulated cpu-bound logic
+      helloworld::HelloReply reply;
+      reply.set_message(request.name());
+      return reply;
+   }
+};
+
+void BM_SayHelloExecutionPolicy(benchmark::State& state)
+{
+   const auto policy = static_cast<Policy>(state.range(0));
+
+   sgrpc::ExecutionContext context{2, 1};
+   sgrpc::ExecutionContext pool{4, 1}; // The "named pool" for heavy logic
+
+   sgrpc::ServerMethodOptions options;
+   options.execution  = (policy == Policy::Inline) ? sgrpc::ExecutionPolicy::Inline
+                                                   : sgrpc::ExecutionPolicy::Offload;
+   options.offload_to = (policy == Policy::OffloadToPool) ? &pool : nullptr;
+
+   auto server  = std::make_shared<BusyServer>();
+   server->work = std::chrono::microseconds{state.range(1)};
+
+   auto container = sgrpc::GenericServerContainer<Service, BusyServer>::make(
+       context,
+       server,
+       [options](BusyServer& server,
+                 Service& service,
+                 sgrpc::Scheduler scheduler,
+                 grpc::ServerCompletionQueue& cq) {
+          new sgrpc::ServerRpcHandler<helloworld::HelloRequest, helloworld::HelloReply>(
+              scheduler,
+              sgrpc::bind_rpc(service, &Service::RequestSayHello),
+              sgrpc::bind_logic(server, &BusyServer::say_hello),
+              cq,
+              options);
+       },
+       sgrpc::ServerOptions{});
+   context.run();
+   pool.run();
+
+   auto channel = grpc::CreateChannel(fmt::format("localhost:{}", container->port()),
+                                      grpc::InsecureChannelCredentials());
+   auto grpc_stub = helloworld::Greeter::NewStub(channel);
+   sgrpc::ClientRpcStub<Stub, helloworld::HelloRequest, helloworld::HelloReply> stub{
+       *grpc_stub, &Stub::PrepareAsyncSayHello};
+
+   struct ConvertResult
+   {
+      std::size_t operator()(helloworld::HelloReply&& reply) { return reply.message().size(); }
+   };
+
+   helloworld::HelloRequest request;
+   request.set_name("Tritarch");
+
+   const auto concurrency = static_cast<std::size_t>(state.range(2));
+   for(auto _ : state) {
+      std::latch done{static_cast<std::ptrdiff_t>(concurrency)};
+      for(std::size_t i = 0; i < concurrency; ++i)
+         stdexec::start_detached(stub.call_inline<std::size_t, ConvertResult>(context, request)
+                                 | stdexec::then([&done](std::size_t) { done.count_down(); })
+                                 | stdexec::upon_error([&done](auto&&) { done.count_down(); }));
+      done.wait();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * concurrency));
+
+   container->grpc_server().Shutdown();
+   container->grpc_server().Wait();
+}
+
+} // namespace
+
+BENCHMARK(BM_SayHelloExecutionPolicy)
+    ->ArgsProduct({{static_cast<int64_t>(Policy::Inline),
+                    static_cast<int64_t>(Policy::Offload),
+                    static_cast<int64_t>(Policy::OffloadToPool)},
+                   {0, 50, 500},
+                   {1, 16}})
+    ->ArgNames({"policy", "work_us", "callers"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,41 @@
+
+#include "stdinc.hpp"
+
+#include "sgrpc/server_metrics.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+/**
+ * The hot-path cost of recording one call into a `MethodMetrics` shared by every thread,
+ * as `ServerRpcHandler` does; run with `->Threads(n)` to see the cost of contention.
+ */
+namespace
+{
+
+sgrpc::MethodMetrics g_metrics{"/helloworld.Greeter/SayHello"};
+
+void BM_RecordCall(benchmark::State& state)
+{
+   const auto arrived = std::chrono::steady_clock::now();
+   const auto started = arrived + std::chrono::microseconds{20};
+   const auto done    = started + std::chrono::microseconds{150};
+   for(auto _ : state) {
+      g_metrics.record_arrival();
+      g_metrics.record_finish(grpc::StatusCode::OK, arrived, started, done);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BM_PrometheusText(benchmark::State& state)
+{
+   sgrpc::ServerMetrics metrics;
+   for(auto i = 0; i < state.range(0); ++i) metrics.method(fmt::format("/bench.Service/M{}", i));
+   for(auto _ : state) benchmark::DoNotOptimize(metrics.prometheus_text());
+}
+
+} // namespace
+
+BENCHMARK(BM_RecordCall)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_PrometheusText)->Arg(1)->Arg(32)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,62 @@
+
+#include "stdinc.hpp"
+
+#include "greeting-grpc/greeting-client.h"
+#include "greeting-grpc/greeting-server.h"
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <latch>
+
+/**
+ * Same-host `SayHello` round trips over `state.range(0)` (0: loopback tcp, 1: unix socket
+ * file, 2: abstract unix socket), with `state.range(1)` concurrent callers.
+ *
+ * With one caller, `real_time` is the round trip latency; with many, `items_per_second` is
+ * the throughput.
+ */
+namespace
+{
+
+std::string make_address(int64_t transport)
+{
+   switch(transport) {
+   case 1: return sgrpc::unix_address(fmt::format("/tmp/sgrpc-benchmark-{}.sock", ::getpid()));
+   case 2: return sgrpc::unix_abstract_address(fmt::format("sgrpc-benchmark-{}", ::getpid()));
+   default: return {}; // Loopback tcp, on a selected port
+   }
+}
+
+void BM_SayHelloTransport(benchmark::State& state)
+{
+   const auto concurrency = static_cast<std::size_t>(state.range(1));
+
+   sgrpc::ExecutionContext context{4, 2};
+   auto server = Greeting::ServerContainer::build(
+       context,
+       std::make_shared<Greeting::Server>(),
+       sgrpc::ServerOptions{.number_work_queues = 2, .address = make_address(state.range(0))});
+   context.run();
+
+   Greeting::Client client{context, sgrpc::make_channel(server.address())};
+
+   for(auto _ : state) {
+      std::latch done{static_cast<std::ptrdiff_t>(concurrency)};
+      for(std::size_t i = 0; i < concurrency; ++i)
+         stdexec::start_detached(client.say_hello("Tritarch")
+                                 | stdexec::then([&done](std::string) { done.count_down(); })
+                                 | stdexec::upon_error([&done](auto&&) { done.count_down(); }));
+      done.wait();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * concurrency));
+}
+
+} // namespace
+
+BENCHMARK(BM_SayHelloTransport)
+    ->ArgsProduct({{0, 1, 2}, {1, 64}})
+    ->ArgNames({"transport", "callers"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -1,12 +1,16 @@
 
 #include "greeting-client.h"
+#include "greeting-server.h"
 
 #include <protos/helloworld.grpc.pb.h>
 
 #include <grpc/support/log.h>
 
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace Greeting
 {
@@ -16,21 +20,87 @@ struct Client::Impl_
 {
    using Service = helloworld::Greeter::Stub;
 
-   explicit Impl_(sgrpc::ExecutionContext& context, std::shared_ptr<grpc::Channel> channel)
+   explicit Impl_(sgrpc::ExecutionContext& context,
+                  std::shared_ptr<grpc::Channel> channel,
+                  const ClientOptions& options)
        : context_{context}
+       , channels_{channel}
        , stub_{helloworld::Greeter::NewStub(channel)}
-       , stub_say_hello_{*stub_, &Service::PrepareAsyncSayHello}
-   {}
+       , stub_say_hello_{std::in_place, *stub_, &Service::PrepareAsyncSayHello}
+   {
+      if(options.backend == sgrpc::RpcBackend::Callback)
+         callback_stub_say_hello_.emplace(channel, "/helloworld.Greeter/SayHello");
+      init_(options);
+   }
+
+   explicit Impl_(sgrpc::ExecutionContext& context,
+                  std::vector<std::string> addresses,
+                  const ClientOptions& options)
+       : context_{context}
+       , balancer_{std::make_shared<sgrpc::EndpointBalancer<Service>>(std::move(addresses))}
+       , stub_say_hello_{std::in_place, balancer_, &Service::PrepareAsyncSayHello}
+   {
+      if(options.backend == sgrpc::RpcBackend::Callback)
+         throw std::invalid_argument{"the callback backend does not balance endpoints"};
+      channels_ = balancer_->channels();
+      init_(options);
+   }
+
+   explicit Impl_(sgrpc::ExecutionContext& context, std::shared_ptr<Server> server)
+       : context_{context}
+       , server_{std::move(server)}
+   {
+      if(server_ == nullptr) throw std::invalid_argument{"requires a server"};
+      direct_stub_say_hello_.emplace(sgrpc::bind_logic(*server_, &Server::say_hello));
+   }
+
+   void init_(const ClientOptions& options)
+   {
+      if(options.eager_connect)
+         for(const auto& channel : channels_) channel->GetState(true); // Starts connecting
+      if(options.wait_for_ready) {
+         stub_say_hello_->set_call_options(sgrpc::ClientCallOptions{.wait_for_ready = true});
+         if(callback_stub_say_hello_)
+            callback_stub_say_hello_->set_call_options(
+                sgrpc::ClientCallOptions{.wait_for_ready = true});
+      }
+   }
 
    sgrpc::ExecutionContext& context_;
-   std::unique_ptr<Service> stub_;
-   sgrpc::ClientRpcStub<Service, helloworld::HelloRequest, helloworld::HelloReply> stub_say_hello_;
+   std::vector<std::shared_ptr<grpc::Channel>> channels_;
+   std::unique_ptr<Service> stub_;                             //!< When bound to one channel
+   std::shared_ptr<sgrpc::EndpointBalancer<Service>> balancer_; //!< When balanced
+   std::shared_ptr<Server> server_; //!< When dispatching directly
+
+   using DirectStub = sgrpc::DirectRpcStub<helloworld::HelloRequest,
+                                           helloworld::HelloReply,
+                                           decltype(sgrpc::bind_logic(std::declval<Server&>(),
+                                                                      &Server::say_hello))>;
+
+   std::optional<
+       sgrpc::ClientRpcStub<Service, helloworld::HelloRequest, helloworld::HelloReply>>
+       stub_say_hello_; //!< Unless dispatching directly
+   std::optional<sgrpc::CallbackClientRpcStub<helloworld::HelloRequest, helloworld::HelloReply>>
+       callback_stub_say_hello_;                      //!< When using the callback backend
+   std::optional<DirectStub> direct_stub_say_hello_; //!< When dispatching directly
 };
 
 // -- Construction/Destruction
 
-Client::Client(sgrpc::ExecutionContext& context, std::shared_ptr<grpc::Channel> channel)
-    : impl_{std::make_unique<Impl_>(context, std::move(channel))}
+Client::Client(sgrpc::ExecutionContext& context,
+               std::shared_ptr<grpc::Channel> channel,
+               ClientOptions options)
+    : impl_{std::make_unique<Impl_>(context, std::move(channel), options)}
+{}
+
+Client::Client(sgrpc::ExecutionContext& context,
+               std::vector<std::string> addresses,
+               ClientOptions options)
+    : impl_{std::make_unique<Impl_>(context, std::move(addresses), options)}
+{}
+
+Client::Client(sgrpc::ExecutionContext& context, std::shared_ptr<Server> server)
+    : impl_{std::make_unique<Impl_>(context, std::move(server))}
 {}
 
 Client::~Client() = default;
@@ -44,11 +114,27 @@ sgrpc::ClientRpcSender<std::string> Client::say_hello(std::string user)
 
    struct ConvertResult
    {
-      std::string operator()(const helloworld::HelloReply& reply) { return reply.message(); }
+      std::string operator()(helloworld::HelloReply&& reply)
+      {
+         return std::move(*reply.mutable_message());
+      }
    };
 
-   return impl_->stub_say_hello_.call<std::string, ConvertResult>(impl_->context_,
-                                                                  std::move(request));
+   if(impl_->direct_stub_say_hello_)
+      return impl_->direct_stub_say_hello_->call<std::string, ConvertResult>(impl_->context_,
+                                                                             std::move(request));
+   if(impl_->callback_stub_say_hello_)
+      return impl_->callback_stub_say_hello_->call<std::string, ConvertResult>(
+          impl_->context_, std::move(request));
+   return impl_->stub_say_hello_->call<std::string, ConvertResult>(impl_->context_,
+                                                                   std::move(request));
+}
+
+// -- Readiness
+
+sgrpc::ChannelReadySender Client::wait_until_ready(std::chrono::system_clock::time_point deadline)
+{
+   return sgrpc::wait_until_ready(impl_->context_, impl_->channels_, deadline);
 }
 
 } // namespace Greeting
@@ -6,6 +6,15 @@
 namespace Greeting
 {
 
+class Server;
+
+struct ClientOptions
+{
+   bool eager_connect{false};  //!< Start connecting on construction, before the first call
+   bool wait_for_ready{false}; //!< Calls wait for the channel to connect, rather than fail fast
+   sgrpc::RpcBackend backend{sgrpc::RpcBackend::CompletionQueue}; //!< Callback: one channel only
+};
+
 /**
  * The client side of the
  */
@@ -15,9 +24,34 @@ class Client final
    //@{ Construction/Destruction
    /**
     * @param context The execution engine to process asynchronous events
-    * @param channel The channel through which to connect to the server
+    * @param channel The channel through which to connect to the server; for a unix socket
+    *                (e.g., "unix:/run/greeting.sock") see `sgrpc::make_channel`, and for a
+    *                server in the same process, see `ServerContainer::in_process_channel`
+    * @param options Connection behaviour
+    */
+   explicit Client(sgrpc::ExecutionContext& context,
+                   std::shared_ptr<grpc::Channel> channel,
+                   ClientOptions options = {});
+
+   /**
+    * @param context The execution engine to process asynchronous events
+    * @param addresses Replicas of the server; calls are load balanced across them. Any
+    *                  may be a unix socket; e.g., "unix:/run/greeting.sock"
+    * @param options Connection behaviour
+    */
+   explicit Client(sgrpc::ExecutionContext& context,
+                   std::vector<std::string> addresses,
+                   ClientOptions options = {});
+
+   /**
+    * Direct dispatch, for a server in the same process: calls `server`'s logic on `context`,
+    * without grpc or serialization. For the full rpc semantics (metadata, deadlines, method
+    * options), pass `ServerContainer::in_process_channel()` instead.
+    *
+    * @param context The execution engine to run the server logic on
+    * @param server The server (logic) to call
     */
-   explicit Client(sgrpc::ExecutionContext& context, std::shared_ptr<grpc::Channel> channel);
+   explicit Client(sgrpc::ExecutionContext& context, std::shared_ptr<Server> server);
    ~Client();
    //@}
 
@@ -26,6 +60,12 @@ class Client final
     */
    sgrpc::ClientRpcSender<std::string> say_hello(std::string user);
 
+   /**
+    * Completes when the channel (or every balanced channel) is connected; e.g., gate a
+    * readiness probe on this, so that traffic only arrives once the client is warm.
+    */
+   sgrpc::ChannelReadySender wait_until_ready(std::chrono::system_clock::time_point deadline);
+
  private:
    /**
     * Use a private implementation to type-erase the client from the underlying grpc types.
@@ -4,6 +4,7 @@
 #include "sgrpc/sgrpc.hpp"
 
 #include <protos/helloworld.grpc.pb.h>
+#include <protos/helloworld.sgrpc.pb.h>
 
 #include <grpc/support/log.h>
 #include <grpcpp/grpcpp.h>
@@ -17,24 +18,26 @@
 namespace Greeting
 {
 
-using Service = helloworld::Greeter::AsyncService;
+using Service = helloworld::GreeterSgrpc::Service;
 
 // # -- Wiring the rpc
 
 namespace detail
 {
-   using namespace helloworld;
+   // Generated by protoc-gen-sgrpc: no std::bind or std::function between grpc and `Server`
+   using Wiring = helloworld::GreeterSgrpc::Server<Server>;
 
    static void wire_rpcs(Server& server,
                          Service& service,
                          sgrpc::Scheduler scheduler,
                          grpc::ServerCompletionQueue& cq)
    {
-      new sgrpc::ServerRpcHandler<HelloRequest, HelloReply>(
-          scheduler,
-          sgrpc::bind_rpc(service, &Service::RequestSayHello),
-          sgrpc::bind_logic(server, &Server::say_hello),
-          cq);
+      Wiring::wire_rpcs(server, service, scheduler, cq);
+   }
+
+   static void wire_callback_rpcs(Server& server, sgrpc::CallbackMethodRouter& router)
+   {
+      Wiring::wire_callback_rpcs(server, router);
    }
 } // namespace detail
 
@@ -42,14 +45,24 @@ namespace detail
 
 struct ServerContainer::Impl
 {
-   uint16_t port() const { return container_->port(); }
+   uint16_t port() const { return container_ ? container_->port() : callback_container_->port(); }
+   std::string address() const
+   {
+      return container_ ? container_->address() : callback_container_->address();
+   }
+   std::shared_ptr<grpc::Channel> in_process_channel() const
+   {
+      return container_ ? container_->in_process_channel()
+                        : callback_container_->in_process_channel();
+   }
    void stop()
    {
-      container_->grpc_server().Shutdown();
       //  TODO: should return a `sender`
-      container_->grpc_server().Wait();
+      if(container_) container_->shutdown();
+      if(callback_container_) callback_container_->shutdown();
    }
    std::shared_ptr<sgrpc::GenericServerContainer<Service, Server>> container_;
+   std::shared_ptr<sgrpc::CallbackServerContainer<Server>> callback_container_;
 };
 
 // # -- The server container, for building and managing a live server
@@ -59,6 +72,11 @@ ServerContainer::ServerContainer()
 {}
 ServerContainer::~ServerContainer() { stop(); }
 uint16_t ServerContainer::port() const { return impl_->port(); }
+std::string ServerContainer::address() const { return impl_->address(); }
+std::shared_ptr<grpc::Channel> ServerContainer::in_process_channel() const
+{
+   return impl_->in_process_channel();
+}
 void ServerContainer::stop() { impl_->stop(); }
 
 // # -- Building the server
@@ -69,15 +87,25 @@ ServerContainer::build(sgrpc::ExecutionContext& execution_context,
                        uint32_t number_server_work_queues,
                        uint16_t port,
                        std::shared_ptr<grpc::ServerCredentials> credentials) noexcept(false)
+{
+   return build(execution_context,
+                server,
+                sgrpc::ServerOptions{.number_work_queues = number_server_work_queues,
+                                     .port               = port,
+                                     .credentials        = std::move(credentials)});
+}
+
+ServerContainer ServerContainer::build(sgrpc::ExecutionContext& execution_context,
+                                       std::shared_ptr<Server> server,
+                                       sgrpc::ServerOptions options) noexcept(false)
 {
    ServerContainer handle;
-   handle.impl_->container_
-       = sgrpc::GenericServerContainer<Service, Server>::make(execution_context,
-                                                              server,
-                                                              detail::wire_rpcs,
-                                                              number_server_work_queues,
-                                                              port,
-                                                              std::move(credentials));
+   if(options.backend == sgrpc::RpcBackend::Callback)
+      handle.impl_->callback_container_ = sgrpc::CallbackServerContainer<Server>::make(
+          execution_context, server, detail::wire_callback_rpcs, std::move(options));
+   else
+      handle.impl_->container_ = sgrpc::GenericServerContainer<Service, Server>::make(
+          execution_context, server, detail::wire_rpcs, std::move(options));
    return handle;
 }
 
@@ -14,7 +14,7 @@ namespace Greeting
 class Server final
 {
  public:
-   helloworld::HelloReply say_hello(const grpc::ServerContext& server_context,
+   helloworld::HelloReply say_hello(const grpc::ServerContextBase& server_context,
                                     const helloworld::HelloRequest& request)
    {
       helloworld::HelloReply reply;
@@ -31,7 +31,11 @@ class ServerContainer
  public:
    ServerContainer();
    ~ServerContainer();    //!< Does a blocking stop of the server on destruction
-   uint16_t port() const; //!< The port the server is listening on
+   uint16_t port() const; //!< The port the server is listening on; zero for unix sockets
+   std::string address() const; //!< Where a same-host client connects, e.g., with `make_channel`
+
+   //!< A channel to the server that skips the network stack; for clients in this process
+   std::shared_ptr<grpc::Channel> in_process_channel() const;
    void stop();           //!< This should return a sender; current implementation is blocking
 
    /**
@@ -49,6 +53,15 @@ class ServerContainer
                                 std::shared_ptr<grpc::ServerCredentials> credentials
                                 = grpc::InsecureServerCredentials()) noexcept(false);
 
+   /**
+    * Creates a new server (instance), with port, work queues, compression, etc. in `options`;
+    * `options.backend` selects completion queues or grpc's callback API, and
+    * `options.address` may be a unix socket (e.g., "unix:/run/greeting.sock")
+    */
+   static ServerContainer build(sgrpc::ExecutionContext& execution_context,
+                                std::shared_ptr<Server> server,
+                                sgrpc::ServerOptions options) noexcept(false);
+
  private:
    struct Impl; // Type erase the grpc code
    std::shared_ptr<Impl> impl_;
@@ -50,9 +50,7 @@ int main(int, char**)
    ctx.run();
    fmt::print("server listening on port:{}\n", server.port());
 
-   auto channel = grpc::CreateChannel(fmt::format("localhost:{}", server.port()),
-                                      grpc::InsecureChannelCredentials());
-   Greeting::Client client{ctx, channel}; // TODO: create with a scheduler (?)
+   Greeting::Client client{ctx, server.in_process_channel()}; // TODO: create with a scheduler (?)
 
    stdexec::sender auto snd = client.say_hello("Tritarch");
 
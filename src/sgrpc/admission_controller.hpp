@@ -0,0 +1,122 @@
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace sgrpc
+{
+
+struct AdmissionControllerOptions
+{
+   std::chrono::milliseconds target_delay{5}; //!< Acceptable delay from arrival to logic start
+   std::chrono::milliseconds interval{100};   //!< How long delay must exceed target to shed
+};
+
+struct AdmissionControllerStats
+{
+   uint64_t admitted{0};
+   uint64_t shed{0};                       //!< Requests rejected with `ResourceExhausted`
+   std::chrono::nanoseconds last_delay{0}; //!< Of the most recent request to start
+   bool is_overloaded{false};              //!< Currently shedding
+};
+
+/**
+ * CoDel-style load shedding for one server method.
+ *
+ * The delay from request arrival to logic start is sampled for every admitted request.
+ * The method is "overloaded" once delay has stayed above `target_delay` for a whole
+ * `interval`, i.e., a standing queue, rather than a burst. While overloaded, requests are
+ * shed at an increasing rate (the `n`th after `interval / sqrt(n)`), just as CoDel drops
+ * packets, until an admitted request starts below target again. So the queue drains back
+ * to target without ever shedding everything, and goodput holds up under overload.
+ *
+ * Share one controller (via `ServerMethodOptions::admission`) between the handlers of a
+ * method on every completion queue.
+ *
+ * THREAD SAFE
+ */
+class AdmissionController final
+{
+ public:
+   using Clock = std::chrono::steady_clock;
+
+   explicit AdmissionController(AdmissionControllerOptions options = {}) noexcept
+       : target_{options.target_delay}
+       , interval_{options.interval}
+   {}
+
+   //!< When a request arrives; `false` => reject it without running any logic
+   bool admit() noexcept { return admit(Clock::now()); }
+
+   //!< As `admit()`, when the request arrived at `now`
+   bool admit(Clock::time_point now) noexcept
+   {
+      std::lock_guard lock{padlock_};
+      const bool is_shed = is_dropping_ && now >= drop_next_;
+      if(is_shed) {
+         ++count_;
+         drop_next_ = control_law_(drop_next_);
+         ++shed_;
+      } else {
+         ++admitted_;
+      }
+      return !is_shed;
+   }
+
+   //!< When the logic of an admitted request starts, `delay` after the request arrived
+   void record(std::chrono::nanoseconds delay) noexcept { record(delay, Clock::now()); }
+
+   //!< As `record(delay)`, when the logic started at `now`
+   void record(std::chrono::nanoseconds delay, Clock::time_point now) noexcept
+   {
+      std::lock_guard lock{padlock_};
+      last_delay_ = delay;
+      if(delay <= target_) { // The queue is (back) below target
+         first_above_.reset();
+         is_dropping_ = false;
+         return;
+      }
+
+      if(!first_above_.has_value()) {
+         first_above_ = now + interval_;
+      } else if(!is_dropping_ && now >= *first_above_) {
+         // Resume near the previous rate, if overloaded only recently
+         is_dropping_ = true;
+         count_       = (count_ > 2 && now - drop_next_ < 16 * interval_) ? count_ - 2 : 1;
+         drop_next_   = control_law_(now);
+      }
+   }
+
+   AdmissionControllerStats stats() const noexcept
+   {
+      std::lock_guard lock{padlock_};
+      return {admitted_, shed_, last_delay_, is_dropping_};
+   }
+
+ private:
+   Clock::time_point control_law_(Clock::time_point from) const noexcept
+   {
+      return from
+             + std::chrono::duration_cast<Clock::duration>(
+                 std::chrono::duration<double, std::nano>{interval_}
+                 / std::sqrt(static_cast<double>(count_)));
+   }
+
+   const std::chrono::nanoseconds target_;
+   const std::chrono::nanoseconds interval_;
+
+   mutable std::mutex padlock_;
+   std::optional<Clock::time_point> first_above_; //!< When delay may start being "standing"
+   Clock::time_point drop_next_;                  //!< When the next request is shed
+   bool is_dropping_{false};
+   uint32_t count_{0}; //!< Shed since overload began
+   std::chrono::nanoseconds last_delay_{0};
+   uint64_t admitted_{0};
+   uint64_t shed_{0};
+};
+
+} // namespace sgrpc
@@ -0,0 +1,89 @@
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <cstddef>
+#include <optional>
+
+namespace sgrpc
+{
+
+enum class CompressionAlgorithm : int { None, Deflate, Gzip };
+
+enum class CompressionLevel : int { None, Low, Medium, High };
+
+/**
+ * How to compress messages. Compression trades CPU for bandwidth, so it pays off for large
+ * payloads only; messages smaller than `min_message_bytes` are sent uncompressed.
+ */
+struct CompressionOptions
+{
+   CompressionAlgorithm algorithm{CompressionAlgorithm::Gzip};
+   CompressionLevel level{CompressionLevel::None}; //!< Server only; overrides `algorithm`
+   std::size_t min_message_bytes{1024};
+};
+
+/**
+ * Options for a client call; set per stub, and override per call.
+ */
+struct ClientCallOptions
+{
+   std::optional<CompressionOptions> compression; //!< Of requests
+   std::optional<bool> wait_for_ready; //!< Wait for the channel to connect, rather than fail fast
+
+   //!< These options, with any fields set in `overrides` replacing them
+   ClientCallOptions merged_with(const ClientCallOptions& overrides) const
+   {
+      ClientCallOptions result = *this;
+      if(overrides.compression.has_value()) result.compression = overrides.compression;
+      if(overrides.wait_for_ready.has_value()) result.wait_for_ready = overrides.wait_for_ready;
+      return result;
+   }
+};
+
+/**
+ * How rpcs are driven: by polling completion queues on the `ExecutionContext`'s threads, or
+ * by grpc's callback (reactor) API on grpc's own threads
+ */
+enum class RpcBackend : int { CompletionQueue, Callback };
+
+namespace detail
+{
+   inline grpc_compression_algorithm to_grpc_compression_algorithm(CompressionAlgorithm algorithm)
+   {
+      switch(algorithm) {
+      case CompressionAlgorithm::None: return GRPC_COMPRESS_NONE;
+      case CompressionAlgorithm::Deflate: return GRPC_COMPRESS_DEFLATE;
+      case CompressionAlgorithm::Gzip: return GRPC_COMPRESS_GZIP;
+      }
+      return GRPC_COMPRESS_NONE;
+   }
+
+   inline grpc_compression_level to_grpc_compression_level(CompressionLevel level)
+   {
+      switch(level) {
+      case CompressionLevel::None: return GRPC_COMPRESS_LEVEL_NONE;
+      case CompressionLevel::Low: return GRPC_COMPRESS_LEVEL_LOW;
+      case CompressionLevel::Medium: return GRPC_COMPRESS_LEVEL_MED;
+      case CompressionLevel::High: return GRPC_COMPRESS_LEVEL_HIGH;
+      }
+      return GRPC_COMPRESS_LEVEL_NONE;
+   }
+
+   //!< Configures `client_context` for sending `request`
+   template<typename RequestType>
+   void apply_call_options(grpc::ClientContext& client_context,
+                           const ClientCallOptions& options,
+                           const RequestType& request)
+   {
+      if(options.compression.has_value()
+         && request.ByteSizeLong() >= options.compression->min_message_bytes)
+         client_context.set_compression_algorithm(
+             to_grpc_compression_algorithm(options.compression->algorithm));
+      if(options.wait_for_ready.has_value())
+         client_context.set_wait_for_ready(*options.wait_for_ready);
+   }
+} // namespace detail
+
+} // namespace sgrpc
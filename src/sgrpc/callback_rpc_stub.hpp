@@ -0,0 +1,115 @@
+
+#pragma once
+
+#include "call_options.hpp"
+#include "rpc_sender.hpp"
+
+#include <grpcpp/generic/generic_stub.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace sgrpc
+{
+
+/**
+ * The client side of a unary method, called through grpc's callback API rather than a
+ * completion queue: grpc's own event engine drives the call, and the result is posted to
+ * the `ExecutionContext`, so that receivers still complete on the `Scheduler`.
+ *
+ * The senders are the same type-erased `ClientRpcSender`s as `ClientRpcStub::call`
+ * returns, so the two stubs can be swapped behind an interface.
+ *
+ * ~~~
+ * CallbackClientRpcStub<HelloRequest, HelloReply> stub{channel, "/helloworld.Greeter/SayHello"};
+ * auto sender = stub.call<std::string, ConvertResult>(context, request);
+ * ~~~
+ */
+template<typename RequestType, typename ResponseType> class CallbackClientRpcStub
+{
+ private:
+   using Stub = grpc::TemplatedGenericStub<RequestType, ResponseType>;
+
+   struct CallData
+   {
+      grpc::ClientContext client_context;
+      RequestType request;
+      ResponseType response;
+   };
+
+ public:
+   CallbackClientRpcStub(std::shared_ptr<grpc::Channel> channel, std::string method)
+       : stub_{std::make_shared<Stub>(std::move(channel))}
+       , method_{std::make_shared<const std::string>(std::move(method))}
+   {}
+
+   template<typename ResultType, typename ConversionFunction>
+   ClientRpcSender<ResultType>
+   call(sgrpc::ExecutionContext& context, RequestType request, ClientCallOptions options = {})
+   {
+      WrappedRpcFactory<ResultType> factory
+          = [&context,
+             stub    = stub_,
+             method  = method_,
+             request = std::move(request),
+             options = call_options_.merged_with(options)](
+                WrappedCompletionHandler<ResultType> completion) -> RpcFactory {
+         return [&context, stub, method, request, options, completion = std::move(completion)](
+                    grpc::CompletionQueue&) -> std::unique_ptr<CompletionQueueEvent> {
+            auto call = std::make_shared<CallData>();
+            call->request = request; // Copied, so that the sender may be re-issued
+            detail::apply_call_options(call->client_context, options, call->request);
+            stub->UnaryCall(&call->client_context,
+                            *method,
+                            grpc::StubOptions{},
+                            &call->request,
+                            &call->response,
+                            [&context, call, method, completion](grpc::Status status) {
+                               auto on_finished = [call, completion, status]() {
+                                  complete_<ResultType, ConversionFunction>(
+                                      completion, status, std::move(call->response));
+                               };
+                               if(!context.post(on_finished)) on_finished(); // Shutting down
+                            });
+            return nullptr; // No completion queue event; grpc owns the call
+         };
+      };
+
+      return {context, std::move(factory)};
+   }
+
+   //!< Like `ClientRpcStub::set_call_options`
+   void set_call_options(ClientCallOptions options) { call_options_ = std::move(options); }
+   const ClientCallOptions& call_options() const noexcept { return call_options_; }
+
+ private:
+   template<typename ResultType, typename ConversionFunction>
+   static void complete_(const WrappedCompletionHandler<ResultType>& completion,
+                         const grpc::Status& status,
+                         ResponseType&& response)
+   {
+      if(!status.ok()) {
+         completion(true, status, {});
+         return;
+      }
+      try {
+         ConversionFunction convert;
+         completion(true, status, std::optional<ResultType>{convert(std::move(response))});
+      } catch(std::exception& e) {
+         completion(true,
+                    grpc::Status{grpc::StatusCode::INTERNAL,
+                                 fmt::format("exception unpacking protobuf, {}", e.what())},
+                    {});
+      } catch(...) {
+         completion(
+             true, grpc::Status{grpc::StatusCode::INTERNAL, "exception unpacking protobuf"}, {});
+      }
+   }
+
+   std::shared_ptr<Stub> stub_;
+   std::shared_ptr<const std::string> method_; //!< Must outlive every call
+   ClientCallOptions call_options_;
+};
+
+} // namespace sgrpc
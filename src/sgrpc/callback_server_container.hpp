@@ -0,0 +1,247 @@
+
+#pragma once
+
+#include "detail/base_inc.hpp"
+#include "detail/server_interface.hpp"
+#include "detail/unary_call.hpp"
+
+#include "execution_context.hpp"
+#include "scheduler.hpp"
+#include "server_method_options.hpp"
+#include "server_options.hpp"
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace sgrpc
+{
+
+namespace detail
+{
+   /**
+    * A unary method served through grpc's callback API. The request is read and parsed on a
+    * grpc thread, and then the logic runs according to `options.execution`, exactly as for a
+    * `ServerRpcHandler`; sender logic is scheduled on the `Scheduler`. Deletes itself when
+    * grpc is done with the call.
+    */
+   template<typename RequestType, typename ResponseType, typename RpcLogic>
+   class CallbackUnaryReactor final
+       : public grpc::ServerGenericBidiReactor
+       , private UnaryCall<CallbackUnaryReactor<RequestType, ResponseType, RpcLogic>,
+                           grpc::GenericCallbackServerContext,
+                           RequestType,
+                           ResponseType,
+                           RpcLogic>
+   {
+    private:
+      using Call = UnaryCall<CallbackUnaryReactor,
+                             grpc::GenericCallbackServerContext,
+                             RequestType,
+                             ResponseType,
+                             RpcLogic>;
+      friend Call;
+
+    public:
+      CallbackUnaryReactor(grpc::GenericCallbackServerContext& server_context,
+                           Scheduler scheduler,
+                           RpcLogic& logic,
+                           const ServerMethodOptions& options)
+          : server_context_{server_context}
+          , scheduler_{scheduler}
+          , logic_{logic}
+          , options_{options}
+      {
+         StartRead(&request_buffer_);
+      }
+
+      void OnReadDone(bool is_ok) override
+      {
+         this->arrive_(options_);
+         if(!is_ok) {
+            this->fail_(grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, "missing request"});
+            return;
+         }
+
+         const auto status = grpc::SerializationTraits<RequestType>::Deserialize(
+             &request_buffer_, &this->request_);
+         if(!status.ok()) {
+            this->fail_(status);
+            return;
+         }
+
+         this->dispatch_(server_context_, logic_, options_, scheduler_);
+      }
+
+      void OnDone() override { delete this; }
+
+    private:
+      static constexpr bool is_raw_ = true; //!< Every generic call is
+
+      void write_serialized_(grpc::ByteBuffer&& response)
+      {
+         response_buffer_.Swap(&response);
+         StartWriteAndFinish(&response_buffer_, grpc::WriteOptions{}, grpc::Status::OK);
+      }
+
+      void finish_with_error_(const grpc::Status& status) { Finish(status); }
+
+      const std::string& method_name_() const { return server_context_.method(); }
+
+      grpc::GenericCallbackServerContext& server_context_;
+      Scheduler scheduler_;
+      RpcLogic& logic_;                    //!< Owned by the router
+      const ServerMethodOptions& options_; //!< Owned by the router
+
+      grpc::ByteBuffer request_buffer_;
+      grpc::ByteBuffer response_buffer_;
+   };
+} // namespace detail
+
+/**
+ * Routes the calls of a `CallbackServerContainer` to their methods, by full method name.
+ */
+class CallbackMethodRouter final : public grpc::CallbackGenericService
+{
+ public:
+   explicit CallbackMethodRouter(Scheduler scheduler)
+       : scheduler_{scheduler}
+   {}
+
+   /**
+    * Serves `method` (e.g., "/helloworld.Greeter/SayHello") with `logic`, which takes
+    * the same arguments, and may return the same types (or senders), as the logic of a
+    * `ServerRpcHandler`.
+    */
+   template<typename RequestType, typename ResponseType, typename RpcLogic>
+   void add_unary(std::string method, RpcLogic logic, ServerMethodOptions options = {})
+   {
+      using Reactor = detail::CallbackUnaryReactor<RequestType, ResponseType, RpcLogic>;
+      methods_.insert_or_assign(
+          std::move(method),
+          [logic = std::move(logic), options = std::move(options)](
+              grpc::GenericCallbackServerContext& server_context,
+              Scheduler scheduler) mutable -> grpc::ServerGenericBidiReactor* {
+             return new Reactor{server_context, scheduler, logic, options};
+          });
+   }
+
+   grpc::ServerGenericBidiReactor*
+   CreateReactor(grpc::GenericCallbackServerContext* server_context) override
+   {
+      auto ii = methods_.find(server_context->method());
+      if(ii == cend(methods_)) return grpc::CallbackGenericService::CreateReactor(server_context);
+      return ii->second(*server_context, scheduler_);
+   }
+
+ private:
+   using ReactorFactory = std::function<grpc::ServerGenericBidiReactor*(
+       grpc::GenericCallbackServerContext&, Scheduler)>;
+
+   Scheduler scheduler_;
+   std::unordered_map<std::string, ReactorFactory> methods_; //!< Fixed once serving
+};
+
+/**
+ * Like `GenericServerContainer`, but served through grpc's callback API: grpc's own event
+ * engine drives the rpcs, so the server has no completion queues for the execution context
+ * to poll, and the context's threads only run the logic that is scheduled onto them.
+ *
+ * ~~~
+ * auto container = CallbackServerContainer<Server>::make(
+ *     context, server, [](Server& server, CallbackMethodRouter& router) {
+ *        router.add_unary<HelloRequest, HelloReply>(
+ *            "/helloworld.Greeter/SayHello", bind_logic(server, &Server::say_hello));
+ *     });
+ * ~~~
+ */
+template<typename Server> class CallbackServerContainer : public ServerContainerInterface
+{
+ public:
+   static std::shared_ptr<CallbackServerContainer>
+   make(ExecutionContext& execution_context,
+        std::shared_ptr<Server> server,
+        std::function<void(Server&, CallbackMethodRouter&)> wire_rpcs,
+        ServerOptions options = {}) noexcept(false)
+   {
+      auto container = std::make_shared<CallbackServerContainer>(execution_context);
+      container->init(std::move(server), std::move(wire_rpcs), std::move(options));
+
+      // Attach to the execution context... so that the container lives until then
+      // execution context is stopped.
+      execution_context.attach_server(container);
+
+      return container;
+   }
+
+   explicit CallbackServerContainer(ExecutionContext& execution_context)
+       : router_{Scheduler{execution_context}}
+   {}
+
+   //@{ Getters
+   uint16_t port() const { return port_; } //!< Zero when listening on a unix socket
+   const std::string& address() const { return address_; } //!< Where local clients connect
+   Server& server() { return *server_; }
+   grpc::Server& grpc_server() { return *grpc_server_; }
+   //@}
+
+   //!< A channel to the server that skips the network stack (messages are still serialized);
+   //!< for clients in this process, with the same rpc semantics as a network channel
+   std::shared_ptr<grpc::Channel> in_process_channel(grpc::ChannelArguments arguments = {})
+   {
+      return grpc_server_->InProcessChannel(arguments);
+   }
+
+   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& get_work_queues() override
+   {
+      return cqs_; // None; grpc polls for itself
+   }
+
+   void shutdown() override
+   {
+      grpc_server_->Shutdown();
+      grpc_server_->Wait();
+   }
+
+ private:
+   void init(std::shared_ptr<Server> server,
+             std::function<void(Server&, CallbackMethodRouter&)> wire_rpcs,
+             ServerOptions options)
+   {
+      // Take control of the server instance
+      server_ = std::move(server);
+
+      // Every method must be routed before the server starts
+      wire_rpcs(*server_, router_);
+
+      grpc::ServerBuilder builder;
+
+      // Set the listening port (and defaults) for this server
+      int selected_port = 0;
+      socket_file_      = detail::UnixSocketFile{options.address};
+      detail::apply_server_options(builder, options, &selected_port);
+      builder.RegisterCallbackGenericService(&router_);
+
+      // Assemble the server.
+      grpc_server_ = builder.BuildAndStart();
+      if(grpc_server_ == nullptr) throw std::runtime_error{"failed to start server"};
+      port_    = detail::is_tcp(options) ? static_cast<uint16_t>(selected_port) : 0;
+      address_ = detail::local_address(options, port_);
+   }
+
+   detail::UnixSocketFile socket_file_; //!< Removed after the server is destroyed
+   CallbackMethodRouter router_;
+   std::unique_ptr<grpc::Server> grpc_server_; //!< The grpc server
+   std::shared_ptr<Server> server_;            //!< The application code server
+   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+   uint16_t port_{0};
+   std::string address_;
+};
+
+} // namespace sgrpc
@@ -0,0 +1,233 @@
+
+#pragma once
+
+#include "detail/base_inc.hpp"
+#include "detail/completion_queue_event.hpp"
+
+#include "execution_context.hpp"
+#include "rpc_status.hpp"
+#include "scheduler.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sgrpc
+{
+
+namespace detail
+{
+   /**
+    * Operation State for `wait_until_ready(...)`: one watcher per channel, each of which
+    * kicks its channel into connecting, and then re-arms `NotifyOnStateChange` on the
+    * execution context's completion queues until the channel is ready (or the deadline
+    * passes). The receiver is completed once every watcher has finished.
+    *
+    * grpc cannot cancel a state watch, so each one waits at most `k_watch_slice`. A stop
+    * request (or `ExecutionContext::stop()`) is thus seen within a slice, rather than holding
+    * the completion queues open until the deadline.
+    */
+   template<typename Receiver> struct ChannelReadyOpState
+   {
+      static constexpr auto k_watch_slice = std::chrono::milliseconds{100};
+
+      struct Watcher final : public CompletionQueueEvent
+      {
+         ChannelReadyOpState* op_{nullptr};
+         std::shared_ptr<grpc::Channel> channel_;
+
+         void watch() noexcept
+         {
+            if(op_->is_stop_requested_.load(std::memory_order_acquire)) {
+               op_->finish(RpcStatusCode::Cancelled);
+               return;
+            }
+
+            // `true` => an idle channel starts connecting, and a failed one retries
+            const auto state = channel_->GetState(true);
+            if(state == GRPC_CHANNEL_READY) {
+               op_->finish(RpcStatusCode::Ok);
+               return;
+            }
+            if(state == GRPC_CHANNEL_SHUTDOWN) {
+               op_->finish(RpcStatusCode::Unavailable);
+               return;
+            }
+            const auto deadline
+                = std::min(op_->deadline_, std::chrono::system_clock::now() + k_watch_slice);
+            const bool posted
+                = op_->context_.post_to_cq([this, state, deadline](grpc::CompletionQueue& cq) {
+                     channel_->NotifyOnStateChange(state, deadline, &cq, this); // scheduled
+                  });
+            if(!posted) op_->finish(RpcStatusCode::Unavailable);
+         }
+
+         void complete(bool is_ok) noexcept override
+         {
+            if(is_ok || std::chrono::system_clock::now() < op_->deadline_)
+               watch(); // The state changed (but maybe not to ready), or the slice ran out
+            else
+               op_->finish(RpcStatusCode::DeadlineExceeded);
+         }
+      };
+
+      using StopToken = stdexec::stop_token_of_t<stdexec::env_of_t<Receiver>>;
+
+      struct OnStopRequested
+      {
+         ChannelReadyOpState* op_;
+         void operator()() noexcept
+         {
+            op_->is_stop_requested_.store(true, std::memory_order_release);
+         }
+      };
+      using StopCallback = typename StopToken::template callback_type<OnStopRequested>;
+
+      ExecutionContext& context_;
+      std::chrono::system_clock::time_point deadline_;
+      [[no_unique_address]] Receiver receiver_;
+      std::vector<Watcher> watchers_;
+      std::atomic<std::size_t> pending_{0};
+      std::atomic<RpcStatusCode> code_{RpcStatusCode::Ok}; //!< The first failure
+      std::atomic<bool> is_stop_requested_{false};
+      std::optional<StopCallback> on_stop_;
+
+      ChannelReadyOpState(ExecutionContext& context,
+                          std::vector<std::shared_ptr<grpc::Channel>>&& channels,
+                          std::chrono::system_clock::time_point deadline,
+                          Receiver&& receiver)
+          : context_{context}
+          , deadline_{deadline}
+          , receiver_{std::move(receiver)}
+          , watchers_(channels.size())
+      {
+         for(std::size_t i = 0; i < channels.size(); ++i) {
+            watchers_[i].op_      = this;
+            watchers_[i].channel_ = std::move(channels[i]);
+         }
+      }
+      ChannelReadyOpState(ChannelReadyOpState&&)            = delete;
+      ChannelReadyOpState& operator=(ChannelReadyOpState&&) = delete;
+
+      friend void tag_invoke(stdexec::start_t, ChannelReadyOpState& self) noexcept
+      {
+         if(self.watchers_.empty()) {
+            stdexec::set_value(std::move(self.receiver_));
+            return;
+         }
+         if constexpr(!stdexec::unstoppable_token<StopToken>)
+            self.on_stop_.emplace(stdexec::get_stop_token(stdexec::get_env(self.receiver_)),
+                                  OnStopRequested{&self});
+         self.pending_.store(self.watchers_.size(), std::memory_order_release);
+         for(auto& watcher : self.watchers_) watcher.watch();
+      }
+
+      void finish(RpcStatusCode code) noexcept
+      {
+         auto expected = RpcStatusCode::Ok;
+         if(code != RpcStatusCode::Ok)
+            code_.compare_exchange_strong(expected, code, std::memory_order_acq_rel);
+
+         if(pending_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+         on_stop_.reset();
+         const auto result = code_.load(std::memory_order_acquire);
+         if(result == RpcStatusCode::Ok)
+            stdexec::set_value(std::move(receiver_));
+         else if(is_stop_requested_.load(std::memory_order_acquire))
+            stdexec::set_stopped(std::move(receiver_));
+         else
+            stdexec::set_error(std::move(receiver_), RpcStatus{result, "channel not ready"});
+      }
+   };
+} // namespace detail
+
+/**
+ * Completes when every channel is connected (`GRPC_CHANNEL_READY`), so that the first rpc
+ * doesn't pay for name resolution, and TCP/TLS/HTTP2 setup. Fails with `DeadlineExceeded`
+ * if a channel isn't ready by the deadline, or `Unavailable` if one is shut down; or
+ * completes with `set_stopped` if stop is requested first.
+ *
+ * The watch runs on the execution context's completion queues; no thread blocks.
+ */
+class ChannelReadySender
+{
+ private:
+   /**
+    * OperationState connect(ChannelReadySender self, Receiver receiver)
+    */
+   template<class R>
+   friend auto tag_invoke(stdexec::connect_t, ChannelReadySender self, R&& receiver)
+   {
+      return detail::ChannelReadyOpState<std::remove_cvref_t<R>>{
+          self.context_, std::move(self.channels_), self.deadline_, std::move(receiver)};
+   }
+
+   /**
+    * Scheduler get_completion_scheduler(ChannelReadySender self)
+    */
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               ChannelReadySender self) noexcept
+   {
+      return Scheduler{self.context_};
+   }
+
+ public:
+   using completion_signatures
+       = stdexec::completion_signatures<stdexec::set_value_t(),
+                                        stdexec::set_error_t(RpcStatus),
+                                        stdexec::set_stopped_t()>;
+
+   ChannelReadySender(ExecutionContext& context,
+                      std::vector<std::shared_ptr<grpc::Channel>> channels,
+                      std::chrono::system_clock::time_point deadline)
+       : context_{context}
+       , channels_{std::move(channels)}
+       , deadline_{deadline}
+   {}
+
+ private:
+   ExecutionContext& context_;
+   std::vector<std::shared_ptr<grpc::Channel>> channels_;
+   std::chrono::system_clock::time_point deadline_;
+};
+
+/**
+ * ~~~
+ * auto channel = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
+ * stdexec::sync_wait(sgrpc::wait_until_ready(context, channel, std::chrono::seconds{5}));
+ * ~~~
+ */
+//@{
+inline ChannelReadySender wait_until_ready(ExecutionContext& context,
+                                           std::vector<std::shared_ptr<grpc::Channel>> channels,
+                                           std::chrono::system_clock::time_point deadline)
+{
+   return {context, std::move(channels), deadline};
+}
+
+inline ChannelReadySender wait_until_ready(ExecutionContext& context,
+                                           std::shared_ptr<grpc::Channel> channel,
+                                           std::chrono::system_clock::time_point deadline)
+{
+   return {context, {std::move(channel)}, deadline};
+}
+
+inline ChannelReadySender wait_until_ready(ExecutionContext& context,
+                                           std::shared_ptr<grpc::Channel> channel,
+                                           std::chrono::nanoseconds timeout)
+{
+   return wait_until_ready(context,
+                           std::move(channel),
+                           std::chrono::system_clock::now()
+                               + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                   timeout));
+}
+//@}
+
+} // namespace sgrpc
@@ -0,0 +1,398 @@
+
+#pragma once
+
+#include "detail/base_inc.hpp"
+#include "detail/utils.hpp"
+
+#include "rpc_status.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace sgrpc
+{
+
+enum class CircuitState : int {
+   Closed,  //!< Calls pass through, and outcomes are counted
+   Open,    //!< Calls fail immediately with `Unavailable`
+   HalfOpen //!< A limited number of probe calls decide whether to close again
+};
+
+struct CircuitBreakerOptions
+{
+   std::size_t window_size{100};    //!< The most recent calls, over which rates are computed
+   std::size_t minimum_calls{20};   //!< Calls in the window before the breaker can open
+   double failure_rate_threshold{0.5};
+   double slow_call_rate_threshold{1.0}; //!< 1.0 => opens only when every call is slow
+   std::chrono::milliseconds slow_call_duration{2000};
+   std::chrono::milliseconds open_duration{5000}; //!< Before moving to half-open
+   std::size_t half_open_probes{3};               //!< Successes required to close again
+   std::vector<RpcStatusCode> failure_codes{RpcStatusCode::Unavailable,
+                                            RpcStatusCode::DeadlineExceeded,
+                                            RpcStatusCode::ResourceExhausted,
+                                            RpcStatusCode::Internal,
+                                            RpcStatusCode::Unknown};
+
+   bool is_failure(RpcStatusCode code) const
+   {
+      return std::find(cbegin(failure_codes), cend(failure_codes), code) != cend(failure_codes);
+   }
+};
+
+struct CircuitBreakerStats
+{
+   CircuitState state{CircuitState::Closed};
+   double failure_rate{0.0};   //!< Over the current window
+   double slow_call_rate{0.0}; //!< Over the current window
+   uint64_t rejected{0};       //!< Calls failed fast while open
+};
+
+/**
+ * A circuit breaker for one endpoint (or backend), driven by the error rate and latency of
+ * the calls made through it.
+ *
+ * + Closed: outcomes are recorded in a window of the most recent calls. Once the window
+ *   holds `minimum_calls`, and the failure (or slow call) rate reaches its threshold, the
+ *   breaker opens.
+ * + Open: calls are rejected without touching grpc, for `open_duration`.
+ * + HalfOpen: up to `half_open_probes` calls are let through at a time. Any failure
+ *   re-opens the breaker; `half_open_probes` successes close it.
+ *
+ * Stopped and cancelled calls are not counted either way; they only free their probe slot.
+ *
+ * Listeners are called on every transition, outside of the breaker's lock.
+ *
+ * THREAD SAFE
+ */
+class CircuitBreaker final
+{
+ public:
+   using clock_type         = std::chrono::steady_clock;
+   using TransitionListener = std::function<void(CircuitState from, CircuitState to)>;
+
+   //!< Permission to make one call; pass back to `record`
+   struct Permit
+   {
+      uint64_t generation; //!< Outcomes from before the last transition are ignored
+      clock_type::time_point started;
+   };
+
+   explicit CircuitBreaker(CircuitBreakerOptions options = {})
+       : options_{std::move(options)}
+       , window_(std::max<std::size_t>(options_.window_size, 1))
+   {}
+
+   //!< Not thread safe with respect to transitions; add listeners before use
+   void add_listener(TransitionListener listener) { listeners_.push_back(std::move(listener)); }
+
+   const CircuitBreakerOptions& options() const noexcept { return options_; }
+
+   //!< `nullopt` if the call must be rejected
+   std::optional<Permit> try_acquire()
+   {
+      const auto now = clock_type::now();
+      std::optional<Transition> transition;
+      std::optional<Permit> permit;
+      {
+         std::lock_guard lock{padlock_};
+         if(state_ == CircuitState::Open && now >= open_until_)
+            transition = transition_locked_(CircuitState::HalfOpen);
+         if(state_ == CircuitState::Open
+            || (state_ == CircuitState::HalfOpen
+                && probes_in_flight_ >= std::max<std::size_t>(options_.half_open_probes, 1))) {
+            ++rejected_;
+         } else {
+            if(state_ == CircuitState::HalfOpen) ++probes_in_flight_;
+            permit = Permit{generation_, now};
+         }
+      }
+      notify_(transition); // Once the permit is decided, so that no other call can interleave
+      return permit;
+   }
+
+   void record(const Permit& permit, bool is_failure)
+   {
+      const bool is_slow = clock_type::now() - permit.started >= options_.slow_call_duration;
+      std::optional<Transition> transition;
+      {
+         std::lock_guard lock{padlock_};
+         transition = record_locked_(permit, is_failure, is_slow);
+      }
+      notify_(transition);
+   }
+
+   //!< Returns a permit without an outcome, e.g., for a call that was stopped or cancelled
+   void release(const Permit& permit)
+   {
+      std::lock_guard lock{padlock_};
+      if(permit.generation != generation_) return; // Stale
+      if(state_ == CircuitState::HalfOpen) --probes_in_flight_;
+   }
+
+   CircuitState state() const
+   {
+      std::lock_guard lock{padlock_};
+      return state_;
+   }
+
+   CircuitBreakerStats stats() const
+   {
+      std::lock_guard lock{padlock_};
+      return {state_, failure_rate_locked_(), slow_call_rate_locked_(), rejected_};
+   }
+
+ private:
+   struct Outcome
+   {
+      bool is_failure{false};
+      bool is_slow{false};
+   };
+
+   struct Transition
+   {
+      CircuitState from;
+      CircuitState to;
+   };
+
+   std::optional<Transition> record_locked_(const Permit& permit, bool is_failure, bool is_slow)
+   {
+      if(permit.generation != generation_) return std::nullopt; // Stale
+
+      if(state_ == CircuitState::HalfOpen) {
+         --probes_in_flight_;
+         if(is_failure) return transition_locked_(CircuitState::Open);
+         if(++probe_successes_ >= std::max<std::size_t>(options_.half_open_probes, 1))
+            return transition_locked_(CircuitState::Closed);
+         return std::nullopt;
+      }
+
+      if(state_ != CircuitState::Closed) return std::nullopt;
+      push_outcome_locked_(is_failure, is_slow);
+      if(count_ < std::max<std::size_t>(options_.minimum_calls, 1)) return std::nullopt;
+      if(failure_rate_locked_() >= options_.failure_rate_threshold
+         || slow_call_rate_locked_() >= options_.slow_call_rate_threshold)
+         return transition_locked_(CircuitState::Open);
+      return std::nullopt;
+   }
+
+   void push_outcome_locked_(bool is_failure, bool is_slow)
+   {
+      auto& slot = window_[next_];
+      if(count_ == window_.size()) { // Overwrite the oldest
+         failures_ -= slot.is_failure;
+         slow_calls_ -= slot.is_slow;
+      } else {
+         ++count_;
+      }
+      slot  = {is_failure, is_slow};
+      next_ = (next_ + 1) % window_.size();
+      failures_ += is_failure;
+      slow_calls_ += is_slow;
+   }
+
+   double failure_rate_locked_() const
+   {
+      return count_ == 0 ? 0.0 : static_cast<double>(failures_) / static_cast<double>(count_);
+   }
+
+   double slow_call_rate_locked_() const
+   {
+      return count_ == 0 ? 0.0 : static_cast<double>(slow_calls_) / static_cast<double>(count_);
+   }
+
+   //!< The listeners are called by `notify_`, once the lock is released
+   Transition transition_locked_(CircuitState to)
+   {
+      const auto from = state_;
+      state_          = to;
+      ++generation_;
+      count_            = 0;
+      next_             = 0;
+      failures_         = 0;
+      slow_calls_       = 0;
+      probes_in_flight_ = 0;
+      probe_successes_  = 0;
+      if(to == CircuitState::Open) open_until_ = clock_type::now() + options_.open_duration;
+      return {from, to};
+   }
+
+   void notify_(const std::optional<Transition>& transition) noexcept
+   {
+      if(!transition.has_value()) return;
+      for(auto& listener : listeners_) {
+         try {
+            listener(transition->from, transition->to);
+         } catch(...) {
+            // TODO: log here
+         }
+      }
+   }
+
+   const CircuitBreakerOptions options_;
+   std::vector<TransitionListener> listeners_;
+
+   mutable std::mutex padlock_;
+   CircuitState state_{CircuitState::Closed};
+   uint64_t generation_{0};
+   clock_type::time_point open_until_{};
+   std::vector<Outcome> window_; //!< Ring buffer
+   std::size_t next_{0};
+   std::size_t count_{0};
+   std::size_t failures_{0};
+   std::size_t slow_calls_{0};
+   std::size_t probes_in_flight_{0};
+   std::size_t probe_successes_{0};
+   uint64_t rejected_{0};
+};
+
+namespace detail
+{
+   //!< Whether `Signatures` include `set_error_t(grpc::Status)`, i.e., a "pure" rpc sender
+   template<typename Signatures> struct HasGrpcStatusError : std::false_type
+   {};
+
+   template<typename... Signatures>
+   struct HasGrpcStatusError<stdexec::completion_signatures<Signatures...>>
+       : std::disjunction<std::is_same<Signatures, stdexec::set_error_t(grpc::Status)>...>
+   {};
+
+   /**
+    * Operation State for `circuit_breaker(...)`
+    */
+   template<typename Sender, typename Receiver> struct CircuitBreakerOpState
+   {
+      struct InnerReceiver
+      {
+         CircuitBreakerOpState* op_;
+
+         template<typename... Values>
+         friend void
+         tag_invoke(stdexec::set_value_t, InnerReceiver&& self, Values&&... values) noexcept
+         {
+            self.op_->breaker_->record(*self.op_->permit_, false);
+            stdexec::set_value(std::move(self.op_->receiver_), std::forward<Values>(values)...);
+         }
+
+         template<typename Error>
+         friend void tag_invoke(stdexec::set_error_t, InnerReceiver&& self, Error&& error) noexcept
+         {
+            auto& breaker   = *self.op_->breaker_;
+            const auto code = status_code_of(error);
+            if(code == RpcStatusCode::Cancelled) // Says nothing about the backend
+               breaker.release(*self.op_->permit_);
+            else
+               breaker.record(*self.op_->permit_,
+                              code.has_value() && breaker.options().is_failure(*code));
+            stdexec::set_error(std::move(self.op_->receiver_), std::forward<Error>(error));
+         }
+
+         friend void tag_invoke(stdexec::set_stopped_t, InnerReceiver&& self) noexcept
+         {
+            self.op_->breaker_->release(*self.op_->permit_); // Neither success nor failure
+            stdexec::set_stopped(std::move(self.op_->receiver_));
+         }
+
+         friend auto tag_invoke(stdexec::get_env_t, const InnerReceiver& self) noexcept
+         {
+            return stdexec::get_env(self.op_->receiver_);
+         }
+      };
+
+      using InnerOpState = stdexec::connect_result_t<Sender, InnerReceiver>;
+
+      Sender sender_;
+      std::shared_ptr<CircuitBreaker> breaker_;
+      [[no_unique_address]] Receiver receiver_;
+      std::optional<CircuitBreaker::Permit> permit_;
+      std::optional<InnerOpState> inner_op_;
+
+      CircuitBreakerOpState(Sender&& sender,
+                            std::shared_ptr<CircuitBreaker>&& breaker,
+                            Receiver&& receiver)
+          : sender_{std::move(sender)}
+          , breaker_{std::move(breaker)}
+          , receiver_{std::move(receiver)}
+      {}
+      CircuitBreakerOpState(CircuitBreakerOpState&&)            = delete;
+      CircuitBreakerOpState& operator=(CircuitBreakerOpState&&) = delete;
+
+      friend void tag_invoke(stdexec::start_t, CircuitBreakerOpState& self) noexcept
+      {
+         self.permit_ = self.breaker_->try_acquire();
+         if(!self.permit_.has_value()) {
+            if constexpr(HasGrpcStatusError<typename Sender::completion_signatures>::value)
+               stdexec::set_error(std::move(self.receiver_),
+                                  grpc::Status{grpc::StatusCode::UNAVAILABLE, "circuit open"});
+            else
+               stdexec::set_error(std::move(self.receiver_),
+                                  RpcStatus{RpcStatusCode::Unavailable, "circuit open"});
+            return;
+         }
+         self.inner_op_.emplace(EmplaceFrom{[&self]() {
+            return stdexec::connect(std::move(self.sender_), InnerReceiver{&self});
+         }});
+         stdexec::start(*self.inner_op_);
+      }
+   };
+} // namespace detail
+
+/**
+ * A sender adaptor that fails fast, with `Unavailable`, while `breaker` is open; and
+ * otherwise records the outcome of `Sender` with the breaker.
+ *
+ * The fast failure is delivered as a `grpc::Status` to senders that fail with a
+ * `grpc::Status` (e.g., `PureClientRpcSender`), and otherwise as an `RpcStatus`.
+ */
+template<typename Sender> class CircuitBreakerSender
+{
+ private:
+   template<class R>
+   friend auto tag_invoke(stdexec::connect_t, CircuitBreakerSender self, R&& receiver)
+   {
+      return detail::CircuitBreakerOpState<Sender, std::remove_cvref_t<R>>{
+          std::move(self.sender_), std::move(self.breaker_), std::move(receiver)};
+   }
+
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               CircuitBreakerSender self) noexcept
+   {
+      return stdexec::get_completion_scheduler<stdexec::set_value_t>(self.sender_);
+   }
+
+ public:
+   using completion_signatures = typename Sender::completion_signatures;
+
+   CircuitBreakerSender(Sender sender, std::shared_ptr<CircuitBreaker> breaker)
+       : sender_{std::move(sender)}
+       , breaker_{std::move(breaker)}
+   {}
+
+ private:
+   Sender sender_;
+   std::shared_ptr<CircuitBreaker> breaker_;
+};
+
+/**
+ * Share one breaker between all the calls to an endpoint. Compose with `retry` by putting
+ * the breaker inside, so that each attempt is checked:
+ * ~~~
+ * auto breaker = std::make_shared<sgrpc::CircuitBreaker>();
+ * breaker->add_listener([](auto from, auto to) { ... });
+ * auto snd = sgrpc::retry(sgrpc::circuit_breaker(client.say_hello("Tritarch"), breaker));
+ * ~~~
+ */
+template<typename Sender>
+CircuitBreakerSender<std::remove_cvref_t<Sender>>
+circuit_breaker(Sender&& sender, std::shared_ptr<CircuitBreaker> breaker)
+{
+   return {std::forward<Sender>(sender), std::move(breaker)};
+}
+
+} // namespace sgrpc
@@ -1,7 +1,12 @@
 
 #pragma once
 
+#include "call_options.hpp"
+#include "concurrency_limiter.hpp"
+#include "endpoint_balancer.hpp"
+#include "response_cache.hpp"
 #include "rpc_sender.hpp"
+#include "single_flight.hpp"
 
 namespace sgrpc
 {
@@ -32,13 +37,28 @@ template<typename Service, typename RequestType, typename ResponseType> class Cl
        : factory_fn_{service, mem_fn_ptr}
    {}
 
+   /**
+    * Spreads calls over the balancer's endpoints. The type-erased `call` picks by power of
+    * two choices, and reports back latency and `Unavailable`s; the other calls just take
+    * any (non-ejected) endpoint.
+    */
+   template<typename MemberFunctionPointer>
+   ClientRpcStub(std::shared_ptr<EndpointBalancer<Service>> balancer,
+                 MemberFunctionPointer mem_fn_ptr)
+       : factory_fn_{mem_fn_ptr}
+       , balancer_{std::move(balancer)}
+   {}
+
    /**
     * The sender here is like a future; The call sends/receives Protobuf envelopes
     */
-   PureClientRpcSender<Service, RequestType, ResponseType> call(sgrpc::ExecutionContext& context,
-                                                                RequestType request)
+   PureClientRpcSender<Service, RequestType, ResponseType>
+   call(sgrpc::ExecutionContext& context, RequestType request, ClientCallOptions options = {})
    {
-      return {context, factory_fn_, std::move(request)};
+      return {context,
+              unmetered_factory_fn_(),
+              std::move(request),
+              call_options_.merged_with(options)};
    }
 
    /**
@@ -46,23 +66,137 @@ template<typename Service, typename RequestType, typename ResponseType> class Cl
     */
    template<typename ResultType,         // The unwrapped result type
             typename ConversionFunction> // Functor to convert from ResponseType => ResultType
-   ClientRpcSender<ResultType> call(sgrpc::ExecutionContext& context, RequestType request)
+   ClientRpcSender<ResultType>
+   call(sgrpc::ExecutionContext& context, RequestType request, ClientCallOptions options = {})
    {
       using CallData
           = detail::CallData<Service, RequestType, ResponseType, ResultType, ConversionFunction>;
 
+      auto call_data = std::make_shared<CallData>(context,
+                                                  factory_fn_,
+                                                  std::move(request),
+                                                  nullptr,
+                                                  cache_,
+                                                  single_flight_,
+                                                  limiter_,
+                                                  balancer_,
+                                                  call_options_.merged_with(options));
+
       WrappedRpcFactory<ResultType> factory
-          = [data = std::make_shared<CallData>(context, factory_fn_, std::move(request))](
+          = [data = std::move(call_data)](
                 WrappedCompletionHandler<ResultType> completion) mutable -> RpcFactory {
          data->completion = std::move(completion);
-         return [data = std::move(data)](grpc::CompletionQueue& cq) mutable { return (*data)(cq); };
+         return [data = std::move(data)](grpc::CompletionQueue& cq) mutable {
+            return CallData::start(std::move(data), cq);
+         };
       };
 
       return {context, std::move(factory)};
    }
 
+   /**
+    * Like the type-erased `call`, but the returned sender is statically typed, so that the
+    * whole rpc is inlined into one operation state, with no allocations beyond grpc's own.
+    * Does not consult the response cache or single-flight group.
+    */
+   template<typename ResultType, typename ConversionFunction>
+   InlineClientRpcSender<Service, RequestType, ResponseType, ResultType, ConversionFunction>
+   call_inline(sgrpc::ExecutionContext& context,
+               RequestType request,
+               ClientCallOptions options   = {},
+               ConversionFunction convert = {})
+   {
+      return {context,
+              unmetered_factory_fn_(),
+              std::move(request),
+              call_options_.merged_with(options),
+              std::move(convert)};
+   }
+
+   /**
+    * Options for every call made through this stub, e.g., compression for large payloads.
+    * Fields set in the options passed to a `call` take precedence.
+    */
+   void set_call_options(ClientCallOptions options) { call_options_ = std::move(options); }
+   const ClientCallOptions& call_options() const noexcept { return call_options_; }
+
+   //@{ Response cache
+   /**
+    * Caches the responses of (type-erased) `call`s, keyed by the serialized request.
+    * A cache hit completes on the context without touching a completion queue.
+    * Only enable for idempotent rpcs.
+    */
+   void enable_cache(ResponseCacheOptions options = {})
+   {
+      cache_ = std::make_shared<ResponseCache<RequestType, ResponseType>>(options);
+   }
+   void disable_cache() { cache_.reset(); }
+
+   //!< Hit rate, evictions, and approximate memory use; all zeros if the cache is disabled
+   ResponseCacheStats cache_stats() const
+   {
+      return cache_ ? cache_->stats() : ResponseCacheStats{};
+   }
+   //@}
+
+   //@{ Single-flight
+   /**
+    * Identical (type-erased) `call`s that are in flight at the same time share one rpc;
+    * every caller receives its own converted copy of the result (or error).
+    */
+   void enable_single_flight()
+   {
+      single_flight_ = std::make_shared<SingleFlightGroup<ResponseType>>();
+   }
+   void disable_single_flight() { single_flight_.reset(); }
+
+   SingleFlightStats single_flight_stats() const
+   {
+      return single_flight_ ? single_flight_->stats() : SingleFlightStats{};
+   }
+   //@}
+
+   //@{ Concurrency limit
+   /**
+    * Limits the (type-erased) `call`s in flight, adapting the limit to observed latency.
+    * Calls over the limit queue (up to `max_queue_length`), or fail with `ResourceExhausted`.
+    * Pass the same limiter to several stubs to limit a whole channel.
+    */
+   void enable_concurrency_limit(ConcurrencyLimiterOptions options = {})
+   {
+      limiter_ = std::make_shared<ConcurrencyLimiter>(options);
+   }
+   void set_concurrency_limiter(std::shared_ptr<ConcurrencyLimiter> limiter)
+   {
+      limiter_ = std::move(limiter);
+   }
+   void disable_concurrency_limit() { limiter_.reset(); }
+
+   //!< The current limit and queue length; all zeros if not limited
+   ConcurrencyLimiterStats concurrency_limiter_stats() const
+   {
+      return limiter_ ? limiter_->stats() : ConcurrencyLimiterStats{};
+   }
+   //@}
+
+   //!< Per-endpoint load and ejections; empty if not balanced
+   std::vector<EndpointStats> endpoint_stats() const
+   {
+      return balancer_ ? balancer_->stats() : std::vector<EndpointStats>{};
+   }
+
  private:
+   ResponseReaderFactory<Service, RequestType, ResponseType> unmetered_factory_fn_()
+   {
+      return balancer_ ? factory_fn_.bind(balancer_->any()) : factory_fn_;
+   }
+
    ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn_;
+   std::shared_ptr<ResponseCache<RequestType, ResponseType>> cache_;
+   std::shared_ptr<SingleFlightGroup<ResponseType>> single_flight_;
+   std::shared_ptr<ConcurrencyLimiter> limiter_;
+   std::shared_ptr<EndpointBalancer<Service>> balancer_;
+   ClientCallOptions call_options_;
 };
 
 } // namespace sgrpc
@@ -0,0 +1,405 @@
+
+#pragma once
+
+#include "detail/base_inc.hpp"
+#include "detail/client_stream_state.hpp"
+
+#include "execution_context.hpp"
+#include "rpc_status.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+namespace sgrpc
+{
+
+namespace detail
+{
+   /**
+    * Cancels the call when the last consumer (stream handle, or sender) lets go of it
+    */
+   template<typename State> struct StreamConsumer
+   {
+      std::shared_ptr<State> state;
+      StreamConsumer(std::shared_ptr<State> state)
+          : state{std::move(state)}
+      {}
+      StreamConsumer(const StreamConsumer&)            = delete;
+      StreamConsumer& operator=(const StreamConsumer&) = delete;
+      ~StreamConsumer() { state->cancel(); }
+   };
+
+   // -- Actions: start one operation on the stream state, completing `receiver`
+
+   struct StreamNextAction
+   {
+      template<typename State, typename Receiver> void operator()(State& state, Receiver& receiver)
+      {
+         state.next([&receiver](auto message, RpcStatus status) {
+            if(!status.ok())
+               stdexec::set_error(std::move(receiver), std::move(status));
+            else
+               stdexec::set_value(std::move(receiver), std::move(message));
+         });
+      }
+   };
+
+   template<typename RequestType> struct StreamWriteAction
+   {
+      RequestType message;
+      template<typename State, typename Receiver> void operator()(State& state, Receiver& receiver)
+      {
+         state.write(std::move(message), [&receiver](RpcStatus status) {
+            if(!status.ok())
+               stdexec::set_error(std::move(receiver), std::move(status));
+            else
+               stdexec::set_value(std::move(receiver));
+         });
+      }
+   };
+
+   struct StreamWritesDoneAction
+   {
+      template<typename State, typename Receiver> void operator()(State& state, Receiver& receiver)
+      {
+         state.writes_done([&receiver](RpcStatus status) {
+            if(!status.ok())
+               stdexec::set_error(std::move(receiver), std::move(status));
+            else
+               stdexec::set_value(std::move(receiver));
+         });
+      }
+   };
+
+   template<bool HasResponse> struct StreamFinishAction
+   {
+      template<typename State, typename Receiver> void operator()(State& state, Receiver& receiver)
+      {
+         state.finish([&receiver](auto response, RpcStatus status) {
+            if(!status.ok())
+               stdexec::set_error(std::move(receiver), std::move(status));
+            else if constexpr(HasResponse)
+               stdexec::set_value(std::move(receiver), std::move(*response));
+            else
+               stdexec::set_value(std::move(receiver));
+         });
+      }
+   };
+
+   /**
+    * Operation State for a single stream operation
+    */
+   template<typename State, typename Action, typename Receiver> struct StreamOpState
+   {
+      std::shared_ptr<StreamConsumer<State>> consumer_;
+      Action action_;
+      [[no_unique_address]] Receiver receiver_;
+
+      StreamOpState(std::shared_ptr<StreamConsumer<State>>&& consumer,
+                    Action&& action,
+                    Receiver&& receiver)
+          : consumer_{std::move(consumer)}
+          , action_{std::move(action)}
+          , receiver_{std::move(receiver)}
+      {}
+      StreamOpState(StreamOpState&&)            = delete;
+      StreamOpState& operator=(StreamOpState&&) = delete;
+
+      friend void tag_invoke(stdexec::start_t, StreamOpState& self) noexcept
+      {
+         self.action_(*self.consumer_->state, self.receiver_);
+      }
+   };
+
+   /**
+    * Operation State for `for_each(...)` over the messages of a stream
+    */
+   template<typename State, typename Function, typename Receiver> struct StreamForEachOpState
+   {
+      std::shared_ptr<StreamConsumer<State>> consumer_;
+      Function function_;
+      [[no_unique_address]] Receiver receiver_;
+
+      StreamForEachOpState(std::shared_ptr<StreamConsumer<State>>&& consumer,
+                           Function&& function,
+                           Receiver&& receiver)
+          : consumer_{std::move(consumer)}
+          , function_{std::move(function)}
+          , receiver_{std::move(receiver)}
+      {}
+      StreamForEachOpState(StreamForEachOpState&&)            = delete;
+      StreamForEachOpState& operator=(StreamForEachOpState&&) = delete;
+
+      friend void tag_invoke(stdexec::start_t, StreamForEachOpState& self) noexcept
+      {
+         self.pump();
+      }
+
+      /**
+       * `next` completes synchronously while messages are buffered, so the messages are
+       * drained in a loop here; the loop is only re-entered from an asynchronous completion.
+       * The receiver is completed after `next` returns, since that may destroy `this`.
+       */
+      void pump() noexcept
+      {
+         for(;;) {
+            state_.store(Pump::InNext, std::memory_order_release);
+            consumer_->state->next([this](auto message, RpcStatus status) {
+               on_message_(std::move(message), std::move(status));
+            });
+            switch(state_.exchange(Pump::Idle, std::memory_order_acq_rel)) {
+            case Pump::Continue: continue; // Completed synchronously
+            case Pump::Finished: finish_(); return;
+            default: return; // The completion will resume the loop
+            }
+         }
+      }
+
+    private:
+      enum class Pump : int { Idle, InNext, Continue, Finished };
+
+      template<typename Message> void on_message_(Message&& message, RpcStatus status) noexcept
+      {
+         if(!status.ok()) {
+            outcome_ = std::move(status);
+         } else if(message.has_value()) {
+            try {
+               function_(std::move(*message));
+               resume_(Pump::Continue);
+               return;
+            } catch(std::exception& e) {
+               consumer_->state->cancel();
+               outcome_ = RpcStatus{RpcStatusCode::Internal, e.what()};
+            } catch(...) {
+               consumer_->state->cancel();
+               outcome_ = RpcStatus{RpcStatusCode::Internal};
+            }
+         }
+         resume_(Pump::Finished);
+      }
+
+      //!< Hands `next_state` to `pump`, if it is still inside `next`, or else acts on it here
+      void resume_(Pump next_state) noexcept
+      {
+         if(state_.exchange(next_state, std::memory_order_acq_rel) == Pump::InNext) return;
+         if(next_state == Pump::Continue)
+            pump();
+         else
+            finish_();
+      }
+
+      void finish_() noexcept
+      {
+         if(outcome_.has_value())
+            stdexec::set_error(std::move(receiver_), std::move(*outcome_));
+         else
+            stdexec::set_value(std::move(receiver_));
+      }
+
+      std::atomic<Pump> state_{Pump::Idle};
+      std::optional<RpcStatus> outcome_; //!< An error, if the stream did not end cleanly
+   };
+} // namespace detail
+
+/**
+ * Sender for one operation on a stream; completes with `Values...` or an `RpcStatus` error
+ */
+template<typename State, typename Action, typename... Values> class StreamSender
+{
+ private:
+   using Consumer = detail::StreamConsumer<State>;
+
+   template<class R> friend auto tag_invoke(stdexec::connect_t, StreamSender self, R&& receiver)
+   {
+      return detail::StreamOpState<State, Action, std::remove_cvref_t<R>>{
+          std::move(self.consumer_), std::move(self.action_), std::move(receiver)};
+   }
+
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               StreamSender self) noexcept
+   {
+      return Scheduler{self.context_};
+   }
+
+ public:
+   using completion_signatures = stdexec::completion_signatures<stdexec::set_value_t(Values...),
+                                                                stdexec::set_error_t(RpcStatus)>;
+
+   StreamSender(ExecutionContext& context, std::shared_ptr<Consumer> consumer, Action action = {})
+       : context_{context}
+       , consumer_{std::move(consumer)}
+       , action_{std::move(action)}
+   {}
+
+ private:
+   ExecutionContext& context_;
+   std::shared_ptr<Consumer> consumer_;
+   Action action_;
+};
+
+/**
+ * Sender that calls `function(ResponseType&&)` for every message of a stream, and
+ * completes (with no value) at the end of the stream.
+ */
+template<typename State, typename Function> class StreamForEachSender
+{
+ private:
+   using Consumer = detail::StreamConsumer<State>;
+
+   template<class R>
+   friend auto tag_invoke(stdexec::connect_t, StreamForEachSender self, R&& receiver)
+   {
+      return detail::StreamForEachOpState<State, Function, std::remove_cvref_t<R>>{
+          std::move(self.consumer_), std::move(self.function_), std::move(receiver)};
+   }
+
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               StreamForEachSender self) noexcept
+   {
+      return Scheduler{self.context_};
+   }
+
+ public:
+   using completion_signatures = stdexec::completion_signatures<stdexec::set_value_t(),
+                                                                stdexec::set_error_t(RpcStatus)>;
+
+   StreamForEachSender(ExecutionContext& context,
+                       std::shared_ptr<Consumer> consumer,
+                       Function function)
+       : context_{context}
+       , consumer_{std::move(consumer)}
+       , function_{std::move(function)}
+   {}
+
+ private:
+   ExecutionContext& context_;
+   std::shared_ptr<Consumer> consumer_;
+   Function function_;
+};
+
+namespace detail
+{
+   /**
+    * The operations shared by the stream handles
+    */
+   template<StreamKind Kind, typename RequestType, typename ResponseType> class ClientStreamBase
+   {
+    protected:
+      using State    = ClientStreamState<Kind, RequestType, ResponseType>;
+      using Consumer = StreamConsumer<State>;
+
+    public:
+      ClientStreamBase(ExecutionContext& context, std::shared_ptr<Consumer> consumer)
+          : context_{context}
+          , consumer_{std::move(consumer)}
+      {}
+
+      //!< Completes with the next message, or `nullopt` at the end of the stream
+      StreamSender<State, StreamNextAction, std::optional<ResponseType>> next() const
+         requires(Kind != StreamKind::ClientStreaming)
+      {
+         return {context_, consumer_};
+      }
+
+      //!< Completes when every message has been passed to `function`
+      template<typename Function>
+      StreamForEachSender<State, std::decay_t<Function>> for_each(Function&& function) const
+         requires(Kind != StreamKind::ClientStreaming)
+      {
+         return {context_, consumer_, std::forward<Function>(function)};
+      }
+
+      //!< Completes when grpc has acknowledged the write; await it before the next write
+      StreamSender<State, StreamWriteAction<RequestType>> write(RequestType message) const
+         requires(Kind != StreamKind::ServerStreaming)
+      {
+         return {context_, consumer_, StreamWriteAction<RequestType>{std::move(message)}};
+      }
+
+      //!< Half-closes the stream, once all writes are done
+      StreamSender<State, StreamWritesDoneAction> writes_done() const
+         requires(Kind != StreamKind::ServerStreaming)
+      {
+         return {context_, consumer_};
+      }
+
+      void cancel() { consumer_->state->cancel(); }
+
+    protected:
+      ExecutionContext& context_;
+      std::shared_ptr<Consumer> consumer_;
+   };
+} // namespace detail
+
+/**
+ * Handle to an in-flight server-streaming rpc. Messages are read incrementally, with at most
+ * `read_ahead` messages buffered ahead of the consumer.
+ *
+ * The call is cancelled when the handle, and every sender created from it, are destroyed
+ * before the end of the stream.
+ *
+ * ~~~
+ * auto stream = stub.call(context, request);
+ * stdexec::sync_wait(stream.for_each([](Row&& row) { ... }));
+ * ~~~
+ */
+template<typename RequestType, typename ResponseType>
+using ClientReader
+    = detail::ClientStreamBase<detail::StreamKind::ServerStreaming, RequestType, ResponseType>;
+
+/**
+ * Handle to an in-flight client-streaming rpc: write messages, then `finish()` for the
+ * response. Writes are acknowledged one at a time, so awaiting each `write` applies
+ * backpressure from the transport.
+ *
+ * ~~~
+ * auto stream = stub.call(context);
+ * for(auto& item : items) stdexec::sync_wait(stream.write(item));
+ * auto [summary] = stdexec::sync_wait(stream.finish()).value();
+ * ~~~
+ */
+template<typename RequestType, typename ResponseType>
+class ClientWriter : public detail::ClientStreamBase<detail::StreamKind::ClientStreaming,
+                                                     RequestType,
+                                                     ResponseType>
+{
+ private:
+   using Base
+       = detail::ClientStreamBase<detail::StreamKind::ClientStreaming, RequestType, ResponseType>;
+
+ public:
+   using Base::Base;
+
+   //!< Half-closes the stream (if not already), and completes with the server's response
+   StreamSender<typename Base::State, detail::StreamFinishAction<true>, ResponseType>
+   finish() const
+   {
+      return {this->context_, this->consumer_};
+   }
+};
+
+/**
+ * Handle to an in-flight bidirectional-streaming rpc. Reads and writes proceed concurrently;
+ * e.g., run `for_each` alongside a chain of `write`s, then `writes_done()`.
+ */
+template<typename RequestType, typename ResponseType>
+class ClientReaderWriter
+    : public detail::ClientStreamBase<detail::StreamKind::Bidirectional, RequestType, ResponseType>
+{
+ private:
+   using Base
+       = detail::ClientStreamBase<detail::StreamKind::Bidirectional, RequestType, ResponseType>;
+
+ public:
+   using Base::Base;
+
+   //!< Completes with the final status, once the server has ended the stream
+   StreamSender<typename Base::State, detail::StreamFinishAction<false>> finish() const
+   {
+      return {this->context_, this->consumer_};
+   }
+};
+
+} // namespace sgrpc
@@ -0,0 +1,173 @@
+
+#pragma once
+
+#include "detail/base_inc.hpp"
+#include "detail/client_stream_state.hpp"
+
+#include "client_stream.hpp"
+#include "execution_context.hpp"
+#include "rpc_status.hpp"
+
+#include <memory>
+
+namespace sgrpc
+{
+
+namespace detail
+{
+   /**
+    * Starts `state` on one of `context`'s completion queues, where
+    * `factory(client_context, response, cq)` creates the grpc stream.
+    */
+   template<typename State, typename StreamFactory>
+   std::shared_ptr<StreamConsumer<State>> start_client_stream(ExecutionContext& context,
+                                                              std::shared_ptr<State> state,
+                                                              StreamFactory factory)
+   {
+      const bool invoked
+          = context.post([state, factory = std::move(factory)](
+                             grpc::CompletionQueue& cq) -> std::unique_ptr<CompletionQueueEvent> {
+               state->start(factory, cq);
+               return nullptr; // The state manages its own lifecycle
+            });
+
+      if(!invoked) state->fail(RpcStatus{RpcStatusCode::Unavailable});
+
+      return std::make_shared<StreamConsumer<State>>(std::move(state));
+   }
+} // namespace detail
+
+/**
+ * The "stub" for the client side of a server-streaming rpc
+ *
+ * ~~~
+ * ClientReaderStub<Service, Request, Row> stub{*grpc_stub, &Service::PrepareAsyncListRows};
+ * ~~~
+ */
+template<typename Service, typename RequestType, typename ResponseType> class ClientReaderStub
+{
+ public:
+   using mem_func_ptr_type = std::unique_ptr<grpc::ClientAsyncReader<ResponseType>> (
+       Service::*)(grpc::ClientContext*, const RequestType&, grpc::CompletionQueue*);
+
+   ClientReaderStub(Service& service, mem_func_ptr_type factory_fn)
+       : service_{service}
+       , factory_fn_{factory_fn}
+   {}
+
+   /**
+    * Starts the call on one of `context`'s completion queues. At most `read_ahead` messages
+    * are buffered ahead of the consumer.
+    */
+   ClientReader<RequestType, ResponseType>
+   call(ExecutionContext& context, RequestType request, std::size_t read_ahead = 16)
+   {
+      using State = detail::ClientStreamState<detail::StreamKind::ServerStreaming,
+                                              RequestType,
+                                              ResponseType>;
+      return {context,
+              detail::start_client_stream(
+                  context,
+                  std::make_shared<State>(read_ahead),
+                  [&service = service_, factory_fn = factory_fn_, request = std::move(request)](
+                      grpc::ClientContext* client_context,
+                      ResponseType*, // Only client-streaming calls have a single response
+                      grpc::CompletionQueue* cq) {
+                     return (service.*factory_fn)(client_context, request, cq);
+                  })};
+   }
+
+ private:
+   Service& service_;
+   mem_func_ptr_type factory_fn_;
+};
+
+/**
+ * The "stub" for the client side of a client-streaming rpc
+ *
+ * ~~~
+ * ClientWriterStub<Service, Item, Summary> stub{*grpc_stub, &Service::PrepareAsyncUpload};
+ * ~~~
+ */
+template<typename Service, typename RequestType, typename ResponseType> class ClientWriterStub
+{
+ public:
+   using mem_func_ptr_type = std::unique_ptr<grpc::ClientAsyncWriter<RequestType>> (
+       Service::*)(grpc::ClientContext*, ResponseType*, grpc::CompletionQueue*);
+
+   ClientWriterStub(Service& service, mem_func_ptr_type factory_fn)
+       : service_{service}
+       , factory_fn_{factory_fn}
+   {}
+
+   //!< Starts the call on one of `context`'s completion queues.
+   ClientWriter<RequestType, ResponseType> call(ExecutionContext& context)
+   {
+      using State = detail::ClientStreamState<detail::StreamKind::ClientStreaming,
+                                              RequestType,
+                                              ResponseType>;
+      return {context,
+              detail::start_client_stream(
+                  context,
+                  std::make_shared<State>(),
+                  [&service = service_, factory_fn = factory_fn_](
+                      grpc::ClientContext* client_context,
+                      ResponseType* response,
+                      grpc::CompletionQueue* cq) {
+                     return (service.*factory_fn)(client_context, response, cq);
+                  })};
+   }
+
+ private:
+   Service& service_;
+   mem_func_ptr_type factory_fn_;
+};
+
+/**
+ * The "stub" for the client side of a bidirectional-streaming rpc
+ *
+ * ~~~
+ * ClientReaderWriterStub<Service, Note, Note> stub{*grpc_stub, &Service::PrepareAsyncChat};
+ * ~~~
+ */
+template<typename Service, typename RequestType, typename ResponseType>
+class ClientReaderWriterStub
+{
+ public:
+   using mem_func_ptr_type
+       = std::unique_ptr<grpc::ClientAsyncReaderWriter<RequestType, ResponseType>> (
+           Service::*)(grpc::ClientContext*, grpc::CompletionQueue*);
+
+   ClientReaderWriterStub(Service& service, mem_func_ptr_type factory_fn)
+       : service_{service}
+       , factory_fn_{factory_fn}
+   {}
+
+   /**
+    * Starts the call on one of `context`'s completion queues. At most `read_ahead` messages
+    * are buffered ahead of the consumer.
+    */
+   ClientReaderWriter<RequestType, ResponseType> call(ExecutionContext& context,
+                                                      std::size_t read_ahead = 16)
+   {
+      using State = detail::ClientStreamState<detail::StreamKind::Bidirectional,
+                                              RequestType,
+                                              ResponseType>;
+      return {context,
+              detail::start_client_stream(
+                  context,
+                  std::make_shared<State>(read_ahead),
+                  [&service = service_, factory_fn = factory_fn_](
+                      grpc::ClientContext* client_context,
+                      ResponseType*, // Only client-streaming calls have a single response
+                      grpc::CompletionQueue* cq) {
+                     return (service.*factory_fn)(client_context, cq);
+                  })};
+   }
+
+ private:
+   Service& service_;
+   mem_func_ptr_type factory_fn_;
+};
+
+} // namespace sgrpc
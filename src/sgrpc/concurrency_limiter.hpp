@@ -0,0 +1,195 @@
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace sgrpc
+{
+
+enum class LimitAlgorithm : int {
+   Aimd,    //!< Additive increase; multiplicative decrease on drops and slow calls
+   Gradient //!< Tracks the ratio of long-term to recent latency
+};
+
+struct ConcurrencyLimiterOptions
+{
+   LimitAlgorithm algorithm{LimitAlgorithm::Gradient};
+   std::size_t initial_limit{20};
+   std::size_t min_limit{1};    //!< Treated as at least 1
+   std::size_t max_limit{1000}; //!< At least `min_limit`
+   std::size_t max_queue_length{0}; //!< Calls over the limit wait here; 0 => fail fast
+
+   //@{ Aimd
+   std::chrono::milliseconds latency_threshold{1000}; //!< Slower calls count as drops
+   double backoff_ratio{0.9};                         //!< Decrease multiplier, in (0, 1)
+   //@}
+
+   //@{ Gradient
+   double smoothing{0.2};         //!< Weight of each new limit estimate, in (0, 1]
+   double latency_tolerance{1.5}; //!< Recent latency may exceed long-term by this ratio
+   std::size_t long_window{600};  //!< Samples (roughly) in the long-term latency average
+   //@}
+};
+
+struct ConcurrencyLimiterStats
+{
+   std::size_t limit{0};
+   std::size_t in_flight{0};
+   std::size_t queue_length{0};
+   uint64_t admitted{0};
+   uint64_t rejected{0}; //!< Failed fast, because the queue was full
+};
+
+/**
+ * Limits the calls that are in flight at once, and adapts that limit to observed latency,
+ * so that when a backend slows down, calls back off instead of piling up.
+ *
+ * Calls over the limit wait in a bounded FIFO, and are admitted as earlier calls release
+ * their permits; if the FIFO is full (or has no room), calls are rejected.
+ *
+ * One limiter may be shared by several stubs, e.g., every stub on a channel.
+ *
+ * THREAD SAFE
+ */
+class ConcurrencyLimiter final
+{
+ public:
+   enum class Admission : int { Admitted, Queued, Rejected };
+
+   explicit ConcurrencyLimiter(ConcurrencyLimiterOptions options = {}) noexcept(false)
+       : options_{validate_(options)}
+       , limit_{static_cast<double>(std::clamp(options.initial_limit,
+                                               std::max<std::size_t>(options.min_limit, 1),
+                                               options.max_limit))}
+   {}
+
+   /**
+    * Takes a permit, if one is available. Otherwise `on_admitted` is queued, and later
+    * called (once, from whichever thread releases a permit) with the permit taken.
+    * `on_admitted` is not stored when the result is `Admitted` or `Rejected`.
+    */
+   Admission acquire(std::function<void()> on_admitted)
+   {
+      std::lock_guard lock{padlock_};
+      if(in_flight_ < current_limit_locked_()) {
+         ++in_flight_;
+         ++admitted_;
+         return Admission::Admitted;
+      }
+      if(waiters_.size() < options_.max_queue_length) {
+         waiters_.push_back(std::move(on_admitted));
+         return Admission::Queued;
+      }
+      ++rejected_;
+      return Admission::Rejected;
+   }
+
+   /**
+    * Returns a permit, and updates the limit with the call's latency. A call is "dropped"
+    * if it timed out, or was refused because the backend was overloaded.
+    */
+   void release(std::chrono::nanoseconds latency, bool is_dropped)
+   {
+      release_([&](std::size_t in_flight) {
+         update_limit_locked_(latency, is_dropped, in_flight);
+      });
+   }
+
+   //!< Returns a permit without a latency sample, e.g., for a call that was never issued
+   void release()
+   {
+      release_([](std::size_t) {});
+   }
+
+   ConcurrencyLimiterStats stats() const
+   {
+      std::lock_guard lock{padlock_};
+      return {current_limit_locked_(), in_flight_, waiters_.size(), admitted_, rejected_};
+   }
+
+ private:
+   std::size_t current_limit_locked_() const { return static_cast<std::size_t>(limit_); }
+
+   //!< `update_limit(in_flight)` is called under the lock, before waiters are admitted
+   template<typename UpdateLimit> void release_(UpdateLimit&& update_limit)
+   {
+      std::vector<std::function<void()>> admitted;
+      {
+         std::lock_guard lock{padlock_};
+         const auto in_flight = in_flight_;
+         --in_flight_;
+         update_limit(in_flight);
+         while(!waiters_.empty() && in_flight_ < current_limit_locked_()) {
+            ++in_flight_;
+            ++admitted_;
+            admitted.push_back(std::move(waiters_.front()));
+            waiters_.pop_front();
+         }
+      }
+      for(auto& on_admitted : admitted) on_admitted();
+   }
+
+   void update_limit_locked_(std::chrono::nanoseconds latency,
+                             bool is_dropped,
+                             std::size_t in_flight)
+   {
+      const double sample = std::chrono::duration<double>(latency).count();
+      // Don't grow the limit when the caller isn't using it; the samples say nothing about it
+      const bool is_app_limited = static_cast<double>(in_flight) * 2.0 < limit_;
+
+      if(options_.algorithm == LimitAlgorithm::Aimd) {
+         const bool is_slow = latency > options_.latency_threshold;
+         if(is_dropped || is_slow)
+            limit_ *= options_.backoff_ratio;
+         else if(!is_app_limited)
+            limit_ += 1.0;
+
+      } else {
+         const double window = static_cast<double>(std::max<std::size_t>(options_.long_window, 1));
+         long_latency_ = (long_latency_ == 0.0)
+                             ? sample
+                             : long_latency_ + (sample - long_latency_) / window;
+         const double gradient
+             = is_dropped ? 0.5
+                          : std::clamp(options_.latency_tolerance * long_latency_
+                                           / std::max(sample, 1e-9),
+                                       0.5,
+                                       1.0);
+         const double headroom  = std::sqrt(limit_); // Room to probe for a higher limit
+         const double estimate  = limit_ * gradient + headroom;
+         const double new_limit = limit_ * (1.0 - options_.smoothing)
+                                  + estimate * options_.smoothing;
+         if(new_limit < limit_ || !is_app_limited) limit_ = new_limit;
+      }
+
+      limit_ = std::clamp(limit_,
+                          static_cast<double>(std::max<std::size_t>(options_.min_limit, 1)),
+                          static_cast<double>(options_.max_limit));
+   }
+
+   static const ConcurrencyLimiterOptions& validate_(const ConcurrencyLimiterOptions& options)
+   {
+      if(options.max_limit < std::max<std::size_t>(options.min_limit, 1))
+         throw std::invalid_argument{"max_limit must be at least min_limit, and 1"};
+      return options;
+   }
+
+   mutable std::mutex padlock_;
+   const ConcurrencyLimiterOptions options_;
+   double limit_;
+   double long_latency_{0.0}; //!< Seconds
+   std::size_t in_flight_{0};
+   std::deque<std::function<void()>> waiters_;
+   uint64_t admitted_{0};
+   uint64_t rejected_{0};
+};
+
+} // namespace sgrpc
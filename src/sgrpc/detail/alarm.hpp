@@ -10,6 +10,11 @@
 namespace sgrpc::detail
 {
 
+/**
+ * Runs a thunk at a deadline, from a completion queue: with `true` once the deadline passes, or
+ * `false` if cancelled (or the queue shuts down). Allocated with `new`; deletes itself once the
+ * thunk has run.
+ */
 class Alarm final : public sgrpc::CompletionQueueEvent
 {
  public:
@@ -22,8 +27,12 @@ class Alarm final : public sgrpc::CompletionQueueEvent
    void complete(bool is_ok) noexcept override
    {
       if(thunk_) { thunk_(is_ok); }
+      delete this;
    }
 
+   //!< Fires the alarm early, with `is_ok == false`; only valid until the thunk has started
+   void cancel() { alarm_.Cancel(); }
+
  private:
    std::function<void(bool)> thunk_;
    grpc::Alarm alarm_;
@@ -0,0 +1,409 @@
+
+#pragma once
+
+#include "stream_event.hpp"
+#include "utils.hpp"
+
+#include "sgrpc/rpc_status.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace sgrpc::detail
+{
+
+enum class StreamKind : int { ServerStreaming, ClientStreaming, Bidirectional };
+
+template<StreamKind Kind, typename RequestType, typename ResponseType> struct ClientStreamTraits;
+
+template<typename RequestType, typename ResponseType>
+struct ClientStreamTraits<StreamKind::ServerStreaming, RequestType, ResponseType>
+{
+   using stream_type = grpc::ClientAsyncReader<ResponseType>;
+};
+
+template<typename RequestType, typename ResponseType>
+struct ClientStreamTraits<StreamKind::ClientStreaming, RequestType, ResponseType>
+{
+   using stream_type = grpc::ClientAsyncWriter<RequestType>;
+};
+
+template<typename RequestType, typename ResponseType>
+struct ClientStreamTraits<StreamKind::Bidirectional, RequestType, ResponseType>
+{
+   using stream_type = grpc::ClientAsyncReaderWriter<RequestType, ResponseType>;
+};
+
+/**
+ * @private
+ * The state of a client-side streaming call: server-streaming (`grpc::ClientAsyncReader`),
+ * client-streaming (`grpc::ClientAsyncWriter`), or bidirectional.
+ *
+ * Reading: messages are read ahead into a bounded buffer; once `read_ahead` messages are
+ * buffered, no further `Read` is issued until the consumer takes one, which pushes back on
+ * the server through grpc's flow control.
+ *
+ * Writing: writes are issued one at a time, and each write's waiter is only completed once
+ * grpc has acknowledged that `Write` on the completion queue. A producer that waits for
+ * each write therefore runs at the pace of the transport.
+ *
+ * `Finish` is issued once no other operation is outstanding and: the server has ended the
+ * stream (reading kinds), `WritesDone` has been acknowledged (client-streaming), or the
+ * stream was cancelled/broken.
+ *
+ * Lifecycle: the state keeps itself alive (`self_`) until grpc delivers the `Finish` event.
+ * When the consumer goes away, `cancel()` must be called so that the call is wound down.
+ *
+ * THREAD SAFE
+ */
+template<StreamKind Kind, typename RequestType, typename ResponseType>
+class ClientStreamState final
+    : public std::enable_shared_from_this<ClientStreamState<Kind, RequestType, ResponseType>>
+{
+ private:
+   static constexpr bool k_reads  = Kind != StreamKind::ClientStreaming;
+   static constexpr bool k_writes = Kind != StreamKind::ServerStreaming;
+
+ public:
+   using stream_type = typename ClientStreamTraits<Kind, RequestType, ResponseType>::stream_type;
+
+   //!< Receives a message; or `nullopt` and the final status at the end of the stream
+   using MessageWaiter = std::function<void(std::optional<ResponseType> message, RpcStatus status)>;
+   using StatusWaiter  = std::function<void(RpcStatus status)>;
+
+   explicit ClientStreamState(std::size_t read_ahead = 1)
+       : read_ahead_{std::max<std::size_t>(read_ahead, 1)}
+   {}
+
+   /**
+    * Must be called on the context (i.e., from an `RpcFactory`) with the completion queue.
+    * `factory(client_context, response, cq)` creates the grpc stream; `response` is where a
+    * client-streaming call writes its single response.
+    */
+   template<typename StreamFactory> void start(StreamFactory&& factory, grpc::CompletionQueue& cq)
+   {
+      std::lock_guard lock{padlock_};
+      self_   = this->shared_from_this();
+      stream_ = factory(&client_context_, &response_, &cq);
+      stream_->StartCall(&start_event_);
+   }
+
+   //!< When the call could not be started at all
+   void fail(RpcStatus status)
+   {
+      std::unique_lock lock{padlock_};
+      status_ = std::move(status);
+      complete_locked_(lock);
+   }
+
+   //!< Cancels the call; buffered messages are discarded
+   void cancel()
+   {
+      std::lock_guard lock{padlock_};
+      if(is_finished_) return;
+      is_cancelled_ = true;
+      buffer_.clear();
+      client_context_.TryCancel();
+      pump_locked_();
+   }
+
+   /**
+    * Takes the next message. `waiter` is called immediately if a message (or the end of the
+    * stream) is available, otherwise from the completion queue when the next `Read` finishes.
+    * Only one `next` may be outstanding at a time.
+    */
+   void next(MessageWaiter waiter)
+      requires k_reads
+   {
+      std::unique_lock lock{padlock_};
+      if(!buffer_.empty()) {
+         auto message = std::move(buffer_.front());
+         buffer_.pop_front();
+         pump_locked_(); // There's room in the buffer again
+         lock.unlock();
+         waiter(std::move(message), RpcStatus{});
+
+      } else if(is_finished_) {
+         lock.unlock();
+         waiter(std::nullopt, status_);
+
+      } else if(read_waiter_) {
+         lock.unlock();
+         waiter(std::nullopt, precondition_failed_("concurrent reads on a stream"));
+
+      } else {
+         read_waiter_ = std::move(waiter);
+      }
+   }
+
+   /**
+    * Queues `message`; `waiter` is called when grpc acknowledges the write.
+    */
+   void write(RequestType message, StatusWaiter waiter)
+      requires k_writes
+   {
+      std::unique_lock lock{padlock_};
+      if(is_finished_ || is_broken_ || is_cancelled_) {
+         lock.unlock();
+         waiter(closed_status_());
+      } else if(writes_done_waiter_) {
+         lock.unlock();
+         waiter(precondition_failed_("write after writes-done"));
+      } else {
+         write_queue_.push_back({std::move(message), std::move(waiter)});
+         pump_locked_();
+      }
+   }
+
+   /**
+    * Half-closes the stream after all queued writes; `waiter` is called on acknowledgement.
+    */
+   void writes_done(StatusWaiter waiter)
+      requires k_writes
+   {
+      std::unique_lock lock{padlock_};
+      if(is_finished_ || is_broken_ || is_cancelled_) {
+         lock.unlock();
+         waiter(closed_status_());
+      } else if(writes_done_waiter_) {
+         lock.unlock();
+         waiter(precondition_failed_("writes-done called twice"));
+      } else {
+         writes_done_waiter_ = std::move(waiter);
+         pump_locked_();
+      }
+   }
+
+   /**
+    * `waiter` receives the final status (and, for client-streaming calls, the response) once
+    * grpc's `Finish` completes. A client-streaming call is half-closed if it isn't already.
+    */
+   void finish(MessageWaiter waiter)
+   {
+      std::unique_lock lock{padlock_};
+      if(is_finished_) {
+         lock.unlock();
+         deliver_finish_(waiter);
+      } else if(finish_waiter_) {
+         lock.unlock();
+         waiter(std::nullopt, precondition_failed_("finish called twice"));
+      } else {
+         finish_waiter_ = std::move(waiter);
+         if constexpr(Kind == StreamKind::ClientStreaming) {
+            if(!writes_done_waiter_) writes_done_waiter_ = [](RpcStatus) {};
+         }
+         pump_locked_();
+      }
+   }
+
+ private:
+   struct QueuedWrite
+   {
+      RequestType message;
+      StatusWaiter waiter;
+   };
+
+   // -- Completion queue events
+
+   void on_started_(bool is_ok)
+   {
+      std::lock_guard lock{padlock_};
+      is_started_ = true;
+      if(!is_ok) is_broken_ = true;
+      pump_locked_();
+   }
+
+   void on_read_(bool is_ok)
+   {
+      MessageWaiter waiter;
+      std::optional<ResponseType> message;
+      {
+         std::lock_guard lock{padlock_};
+         is_read_pending_ = false;
+         if(!is_ok) {
+            is_reads_done_ = true; // The server has ended the stream
+         } else if(is_cancelled_) {
+            // Discard
+         } else if(read_waiter_) {
+            message = std::move(incoming_);
+            std::swap(waiter, read_waiter_);
+         } else {
+            buffer_.push_back(std::move(incoming_));
+         }
+         pump_locked_();
+      }
+      if(waiter) waiter(std::move(message), RpcStatus{});
+   }
+
+   void on_write_(bool is_ok)
+   {
+      StatusWaiter waiter;
+      {
+         std::lock_guard lock{padlock_};
+         is_write_pending_ = false;
+         if(!is_ok) is_broken_ = true;
+         std::swap(waiter, write_waiter_);
+         pump_locked_();
+      }
+      waiter(is_ok ? RpcStatus{} : closed_status_());
+   }
+
+   void on_writes_done_(bool is_ok)
+   {
+      StatusWaiter waiter;
+      {
+         std::lock_guard lock{padlock_};
+         is_write_pending_      = false;
+         is_writes_done_acked_ = true;
+         if(!is_ok) is_broken_ = true;
+         std::swap(waiter, writes_done_waiter_);
+         writes_done_waiter_ = [](RpcStatus) {}; // Still "requested"
+         pump_locked_();
+      }
+      waiter(is_ok ? RpcStatus{} : closed_status_());
+   }
+
+   void on_finished_(bool is_ok)
+   {
+      auto self = std::move(self_); // `this` may be deleted when `self` goes out of scope
+      std::unique_lock lock{padlock_};
+      if(!is_ok)
+         status_ = RpcStatus{RpcStatusCode::Unavailable};
+      else if(!grpc_status_.ok())
+         status_ = RpcStatus{to_rpc_status_code(grpc_status_.error_code()),
+                             grpc_status_.error_message()};
+      complete_locked_(lock);
+   }
+
+   // -- Issuing operations
+
+   void pump_locked_()
+   {
+      if(!is_started_ || is_finish_issued_) return;
+      const bool is_closing = is_broken_ || is_cancelled_;
+
+      if constexpr(k_reads) {
+         if(!is_closing && !is_read_pending_ && !is_reads_done_ && buffer_.size() < read_ahead_) {
+            is_read_pending_ = true;
+            incoming_.Clear();
+            stream_->Read(&incoming_, &read_event_);
+         }
+      }
+
+      if constexpr(k_writes) {
+         if(!is_closing && !is_write_pending_ && !is_writes_done_issued_) {
+            if(!write_queue_.empty()) {
+               is_write_pending_ = true;
+               outgoing_         = std::move(write_queue_.front().message);
+               write_waiter_     = std::move(write_queue_.front().waiter);
+               write_queue_.pop_front();
+               stream_->Write(outgoing_, &write_event_);
+            } else if(writes_done_waiter_) {
+               is_write_pending_      = true;
+               is_writes_done_issued_ = true;
+               stream_->WritesDone(&writes_done_event_);
+            }
+         }
+      }
+
+      const bool is_idle = !is_read_pending_ && !is_write_pending_;
+      const bool is_done = is_closing || (k_reads ? is_reads_done_ : is_writes_done_acked_);
+      if(is_idle && is_done) {
+         is_finish_issued_ = true;
+         stream_->Finish(&grpc_status_, &finish_event_);
+      }
+   }
+
+   // -- Delivering the final status
+
+   void complete_locked_(std::unique_lock<std::mutex>& lock)
+   {
+      is_finished_ = true;
+
+      MessageWaiter read_waiter;
+      if(buffer_.empty()) std::swap(read_waiter, read_waiter_);
+      MessageWaiter finish_waiter;
+      std::swap(finish_waiter, finish_waiter_);
+      std::deque<QueuedWrite> writes;
+      std::swap(writes, write_queue_);
+      StatusWaiter writes_done_waiter;
+      if(!is_writes_done_issued_) std::swap(writes_done_waiter, writes_done_waiter_);
+      lock.unlock();
+
+      const auto closed_status = status_.ok() ? closed_status_() : status_;
+      for(auto& write : writes) write.waiter(closed_status);
+      if(writes_done_waiter) writes_done_waiter(closed_status);
+      if(read_waiter) read_waiter(std::nullopt, status_);
+      if(finish_waiter) deliver_finish_(finish_waiter);
+   }
+
+   void deliver_finish_(const MessageWaiter& waiter)
+   {
+      if constexpr(Kind == StreamKind::ClientStreaming) {
+         if(status_.ok()) {
+            waiter(std::move(response_), status_);
+            return;
+         }
+      }
+      waiter(std::nullopt, status_);
+   }
+
+   static RpcStatus closed_status_()
+   {
+      return RpcStatus{RpcStatusCode::Unavailable, "the stream is closed"};
+   }
+
+   static RpcStatus precondition_failed_(const char* details)
+   {
+      return RpcStatus{RpcStatusCode::FailedPrecondition, details};
+   }
+
+   // -- Members
+
+   std::mutex padlock_;
+   grpc::ClientContext client_context_;
+   std::unique_ptr<stream_type> stream_;
+
+   StreamEvent<ClientStreamState> start_event_{*this, &ClientStreamState::on_started_};
+   StreamEvent<ClientStreamState> read_event_{*this, &ClientStreamState::on_read_};
+   StreamEvent<ClientStreamState> write_event_{*this, &ClientStreamState::on_write_};
+   StreamEvent<ClientStreamState> writes_done_event_{*this, &ClientStreamState::on_writes_done_};
+   StreamEvent<ClientStreamState> finish_event_{*this, &ClientStreamState::on_finished_};
+
+   ResponseType incoming_;           //!< Target of the outstanding `Read`
+   std::deque<ResponseType> buffer_; //!< Read ahead, but not yet taken
+   const std::size_t read_ahead_;    //!< Maximum size of `buffer_`
+   MessageWaiter read_waiter_;       //!< The consumer, waiting on the next `Read`
+
+   RequestType outgoing_;                //!< Source of the outstanding `Write`
+   std::deque<QueuedWrite> write_queue_; //!< Not yet written
+   StatusWaiter write_waiter_;           //!< Waiting on the outstanding `Write`
+   StatusWaiter writes_done_waiter_;     //!< Set when writes-done is requested
+
+   ResponseType response_;      //!< The response of a client-streaming call
+   MessageWaiter finish_waiter_;
+   grpc::Status grpc_status_; //!< Set by `Finish`
+   RpcStatus status_;         //!< Final status of the stream
+
+   bool is_started_{false};
+   bool is_read_pending_{false};
+   bool is_reads_done_{false};
+   bool is_write_pending_{false}; //!< A `Write` or `WritesDone` is outstanding
+   bool is_writes_done_issued_{false};
+   bool is_writes_done_acked_{false};
+   bool is_finish_issued_{false};
+   bool is_finished_{false};
+   bool is_broken_{false}; //!< A start/write failed
+   bool is_cancelled_{false};
+
+   std::shared_ptr<ClientStreamState> self_; //!< Alive while grpc holds tags into this object
+};
+
+} // namespace sgrpc::detail
@@ -19,9 +19,12 @@ using AsyncReaderFactory
     = std::function<std::unique_ptr<grpc::ClientAsyncResponseReader<ResponseType>>(
         grpc::ClientContext& client_context)>;
 
+/**
+ * Called once, when the rpc completes; the response is handed over (as an rvalue), so that
+ * large fields can be moved out of it rather than copied.
+ */
 template<typename ResponseType>
-using CompletionThunk
-    = std::function<void(bool, const grpc::Status&, const ResponseType& response)>;
+using CompletionThunk = std::function<void(bool, const grpc::Status&, ResponseType&& response)>;
 
 /**
  * An "in-flight" RPC call; lives on the heap; lifecycle managed externally
@@ -45,7 +48,7 @@ template<typename ResponseType> class InflightRpc : public CompletionQueueEvent
    {
       assert(completion_);
       try {
-         completion_(is_ok, status_, response_);
+         completion_(is_ok, status_, std::move(response_));
       } catch(...) {
          // TODO: log something here
       }
@@ -0,0 +1,106 @@
+
+#pragma once
+
+#include "base_inc.hpp"
+#include "completion_queue_event.hpp"
+#include "response_reader_factory.hpp"
+#include "utils.hpp"
+
+#include "sgrpc/call_options.hpp"
+#include "sgrpc/execution_context.hpp"
+#include "sgrpc/rpc_status.hpp"
+
+#include <fmt/format.h>
+
+#include <grpcpp/grpcpp.h>
+
+namespace sgrpc::detail
+{
+
+/**
+ * Operation State for a statically typed RPC Sender.
+ *
+ * The operation state _is_ the in-flight rpc: it embeds the client context, response
+ * reader, response, conversion functor, and receiver, and is itself the completion queue
+ * tag. Nothing is type-erased, and nothing is allocated beyond what grpc allocates for
+ * the call itself.
+ *
+ * The operation state must outlive the rpc, which the sender/receiver contract guarantees:
+ * it is not destroyed until after the receiver is completed.
+ */
+template<typename Service,
+         typename RequestType,
+         typename ResponseType,
+         typename ResultType,
+         typename ConversionFunction,
+         typename Receiver>
+struct InlineRpcOpState final : public CompletionQueueEvent
+{
+   ExecutionContext& context_;
+   ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn_;
+   RequestType request_;
+   ClientCallOptions options_;
+   [[no_unique_address]] ConversionFunction convert_;
+   [[no_unique_address]] Receiver receiver_;
+
+   grpc::ClientContext client_context_;
+   grpc::Status status_;
+   ResponseType response_;
+   std::unique_ptr<grpc::ClientAsyncResponseReader<ResponseType>> response_reader_;
+
+   InlineRpcOpState(ExecutionContext& context,
+                    ResponseReaderFactory<Service, RequestType, ResponseType>&& factory_fn,
+                    RequestType&& request,
+                    ClientCallOptions&& options,
+                    ConversionFunction&& convert,
+                    Receiver&& receiver)
+       : context_{context}
+       , factory_fn_{std::move(factory_fn)}
+       , request_{std::move(request)}
+       , options_{std::move(options)}
+       , convert_{std::move(convert)}
+       , receiver_{std::move(receiver)}
+   {}
+   InlineRpcOpState(InlineRpcOpState&&)            = delete;
+   InlineRpcOpState& operator=(InlineRpcOpState&&) = delete;
+
+   friend void tag_invoke(stdexec::start_t, InlineRpcOpState& self) noexcept { self.invoke(); }
+
+   void invoke() noexcept
+   {
+      const bool invoked = context_.post_to_cq([this](grpc::CompletionQueue& cq) {
+         apply_call_options(client_context_, options_, request_);
+         response_reader_ = factory_fn_(&client_context_, request_, &cq);
+         response_reader_->StartCall();
+         response_reader_->Finish(&response_, &status_, this); // scheduled
+      });
+      if(!invoked) stdexec::set_error(std::move(receiver_), RpcStatus{RpcStatusCode::Unavailable});
+   }
+
+   void complete(bool is_ok) noexcept override
+   {
+      if(!is_ok) {
+         stdexec::set_error(std::move(receiver_), RpcStatus{RpcStatusCode::Unavailable});
+
+      } else if(!status_.ok()) {
+         stdexec::set_error(
+             std::move(receiver_),
+             RpcStatus{to_rpc_status_code(status_.error_code()), status_.error_message()});
+
+      } else {
+         try {
+            stdexec::set_value(std::move(receiver_), ResultType{convert_(std::move(response_))});
+         } catch(std::exception& e) {
+            stdexec::set_error(
+                std::move(receiver_),
+                RpcStatus{RpcStatusCode::Internal,
+                          fmt::format("exception unpacking protobuf, {}", e.what())});
+         } catch(...) {
+            stdexec::set_error(std::move(receiver_),
+                               RpcStatus{RpcStatusCode::Internal, "exception unpacking protobuf"});
+         }
+      }
+   }
+};
+
+} // namespace sgrpc::detail
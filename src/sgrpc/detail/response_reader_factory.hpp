@@ -3,6 +3,8 @@
 
 #include "inflight_rpc.hpp"
 
+#include <cassert>
+
 namespace sgrpc {
 
 /**
@@ -26,16 +28,30 @@ struct ResponseReaderFactory {
 
   // Want to implicitly construct from a service stub member function
   ResponseReaderFactory(Service& service, mem_func_ptr_type factory_fn)
-      : service_{service}, factory_fn_{factory_fn} {}
+      : service_{&service}, factory_fn_{factory_fn} {}
+
+  // Unbound; the service must be passed on each call, e.g., when load balancing
+  explicit ResponseReaderFactory(mem_func_ptr_type factory_fn)
+      : service_{nullptr}, factory_fn_{factory_fn} {}
+
+  ResponseReaderFactory bind(Service& service) const { return {service, factory_fn_}; }
 
   std::unique_ptr<response_reader_type> operator()(grpc::ClientContext* client_context,
                                                    const request_type& request,
                                                    grpc::CompletionQueue* cq) {
-    return (service_.*factory_fn_)(client_context, request, cq);
+    assert(service_ != nullptr);
+    return (service_->*factory_fn_)(client_context, request, cq);
+  }
+
+  std::unique_ptr<response_reader_type> operator()(Service& service,
+                                                   grpc::ClientContext* client_context,
+                                                   const request_type& request,
+                                                   grpc::CompletionQueue* cq) {
+    return (service.*factory_fn_)(client_context, request, cq);
   }
 
 private:
-  Service& service_;
+  Service* service_;
   mem_func_ptr_type factory_fn_;
 };
 
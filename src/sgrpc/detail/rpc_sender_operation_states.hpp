@@ -6,8 +6,13 @@
 #include "response_reader_factory.hpp"
 #include "utils.hpp"
 
+#include "sgrpc/call_options.hpp"
+#include "sgrpc/concurrency_limiter.hpp"
+#include "sgrpc/endpoint_balancer.hpp"
 #include "sgrpc/execution_context.hpp"
+#include "sgrpc/response_cache.hpp"
 #include "sgrpc/rpc_status.hpp"
+#include "sgrpc/single_flight.hpp"
 
 #include <fmt/format.h>
 #include <functional>
@@ -15,8 +20,8 @@
 namespace sgrpc
 {
 template<typename ResultType>
-using WrappedCompletionHandler
-    = std::function<void(bool is_ok, const grpc::Status& status, std::optional<ResultType> result)>;
+using WrappedCompletionHandler = std::function<
+    void(bool is_ok, const grpc::Status& status, std::optional<ResultType>&& result)>;
 
 template<typename ResultType>
 using WrappedRpcFactory
@@ -35,13 +40,18 @@ struct PureRpcSenderOpState
    ExecutionContext& context_;
    ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn_;
    RequestType request_;
+   ClientCallOptions options_;
    [[no_unique_address]] Receiver receiver_;
 
    PureRpcSenderOpState(ExecutionContext& context,
                         ResponseReaderFactory<Service, RequestType, ResponseType>&& factory_fn,
+                        RequestType&& request,
+                        ClientCallOptions&& options,
                         Receiver&& receiver)
        : context_{context}
        , factory_fn_{std::move(factory_fn)}
+       , request_{std::move(request)}
+       , options_{std::move(options)}
        , receiver_{std::move(receiver)}
    {}
    PureRpcSenderOpState(PureRpcSenderOpState&&)            = delete;
@@ -55,13 +65,14 @@ struct PureRpcSenderOpState
           [this](grpc::CompletionQueue& cq) mutable -> std::unique_ptr<CompletionQueueEvent> {
              // Factory for creating the correct response writer type
              auto reader_factory = [this, &cq](grpc::ClientContext& client_context) mutable {
+                apply_call_options(client_context, options_, request_);
                 return factory_fn_(&client_context, std::move(request_), &cq);
              };
 
              // Sets the value on the receiver when the rpc call completes
              auto completion = [this](bool is_ok,
                                       const grpc::Status& status,
-                                      const ResponseType& response) mutable {
+                                      ResponseType&& response) mutable {
                 if(!is_ok) {
                    stdexec::set_error(std::move(receiver_),
                                       grpc::Status{grpc::StatusCode::UNAVAILABLE,
@@ -115,33 +126,164 @@ struct CallData
    ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn; //!< Prepares the rpc
    RequestType request;                                                  //!< Input to rpc
    WrappedCompletionHandler<ResultType> completion;                      //!< Put result on Receiver
+   std::shared_ptr<ResponseCache<RequestType, ResponseType>> cache;      //!< Optional
+   std::shared_ptr<SingleFlightGroup<ResponseType>> single_flight;       //!< Optional
+   std::shared_ptr<ConcurrencyLimiter> limiter;                          //!< Optional
+   std::shared_ptr<EndpointBalancer<Service>> balancer;                  //!< Optional
+   ClientCallOptions call_options;                                       //!< E.g., compression
 
-   std::unique_ptr<CompletionQueueEvent> operator()(grpc::CompletionQueue& cq)
+   /**
+    * Starts the call on `cq`. Takes shared ownership, because a call that is queued by the
+    * concurrency limiter is issued later, from another completion.
+    */
+   static std::unique_ptr<CompletionQueueEvent> start(std::shared_ptr<CallData> self,
+                                                      grpc::CompletionQueue& cq)
    {
-      auto factory = [this, &cq](grpc::ClientContext& client_context) mutable {
-         return factory_fn(&client_context, std::move(request), &cq);
-      };
+      auto& cache         = self->cache;
+      auto& single_flight = self->single_flight;
+      using Cache         = ResponseCache<RequestType, ResponseType>;
+      const std::string key
+          = (cache || single_flight) ? Cache::make_key(self->request) : std::string{};
+
+      if(cache) {
+         if(auto cached = cache->find(key); cached.has_value()) {
+            // Cache hit: complete on the context, without touching the completion queue
+            const bool did_post
+                = self->context.post([self, response = std::move(*cached)]() mutable {
+                     convert_and_complete(
+                         self->completion, true, grpc::Status::OK, std::move(response));
+                  });
+            if(!did_post) // Shutting down
+               convert_and_complete(self->completion, false, grpc::Status::CANCELLED, {});
+            return nullptr;
+         }
+      }
+
+      CompletionThunk<ResponseType> on_finished
+          = [completion = std::move(self->completion)](
+                bool is_ok, const grpc::Status& status, ResponseType&& response) {
+               convert_and_complete(completion, is_ok, status, std::move(response));
+            };
+
+      if(single_flight) {
+         if(!single_flight->join(key, std::move(on_finished)))
+            return nullptr; // An identical rpc is in flight, and will complete this call too
 
-      auto curried_completion = [completion = std::move(completion)](bool is_ok,
-                                                                     const grpc::Status& status,
-                                                                     const ResponseType& response) {
-         try {
-            ConversionFunction convert;
-            completion(is_ok, status, convert(response));
-         } catch(std::exception& e) {
-            completion(is_ok,
-                       grpc::Status{grpc::StatusCode::INTERNAL,
-                                    fmt::format("exception unpacking protobuf, {}", e.what())},
-                       {});
-         } catch(...) {
-            completion(is_ok,
-                       grpc::Status{grpc::StatusCode::INTERNAL, "exception unpacking protobuf"},
-                       {});
+         on_finished = [flights = single_flight, key](
+                           bool is_ok, const grpc::Status& status, ResponseType&& response) {
+            flights->finish(key, is_ok, status, std::move(response));
+         };
+      }
+
+      if(cache) { // Insert before `finish`, so that new callers hit the cache
+         on_finished = [cache = cache, key, next = std::move(on_finished)](
+                           bool is_ok, const grpc::Status& status, ResponseType&& response) {
+            if(is_ok && status.ok()) cache->insert(key, response); // The only copy
+            next(is_ok, status, std::move(response));
+         };
+      }
+
+      if(self->limiter) {
+         using Admission = ConcurrencyLimiter::Admission;
+         const auto admission = self->limiter->acquire([self, on_finished]() {
+            // Admitted later, from the completion of another call: issue on a fresh post
+            const bool invoked = self->context.post(
+                [self, on_finished](grpc::CompletionQueue& queue) mutable {
+                   return issue_(*self, queue, std::move(on_finished));
+                });
+            if(!invoked) {
+               self->limiter->release(); // Never issued, so no latency sample
+               on_finished(false, grpc::Status::CANCELLED, ResponseType{});
+            }
+         });
+
+         if(admission == Admission::Queued) return nullptr;
+         if(admission == Admission::Rejected) {
+            const bool did_post = self->context.post([on_finished]() {
+               on_finished(true,
+                           grpc::Status{grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                        "client concurrency limit exceeded"},
+                           ResponseType{});
+            });
+            if(!did_post) on_finished(false, grpc::Status::CANCELLED, ResponseType{});
+            return nullptr;
          }
+      }
+
+      return issue_(*self, cq, std::move(on_finished));
+   }
+
+   /**
+    * `ConversionFunction` is passed the response as an rvalue, so it may move fields out of
+    * it, e.g., `std::move(*response.mutable_payload())`; the result is moved to the receiver.
+    */
+   static void convert_and_complete(const WrappedCompletionHandler<ResultType>& completion,
+                                    bool is_ok,
+                                    const grpc::Status& status,
+                                    ResponseType&& response)
+   {
+      try {
+         ConversionFunction convert;
+         completion(is_ok, status, std::optional<ResultType>{convert(std::move(response))});
+      } catch(std::exception& e) {
+         completion(is_ok,
+                    grpc::Status{grpc::StatusCode::INTERNAL,
+                                 fmt::format("exception unpacking protobuf, {}", e.what())},
+                    {});
+      } catch(...) {
+         completion(
+             is_ok, grpc::Status{grpc::StatusCode::INTERNAL, "exception unpacking protobuf"}, {});
+      }
+   }
+
+ private:
+   //!< Creates the rpc; when limited, the permit is released (with a latency sample) at the end
+   static std::unique_ptr<CompletionQueueEvent>
+   issue_(CallData& self, grpc::CompletionQueue& cq, CompletionThunk<ResponseType> on_finished)
+   {
+      if(self.limiter) {
+         on_finished = [limiter = self.limiter,
+                        started = std::chrono::steady_clock::now(),
+                        next    = std::move(on_finished)](
+                           bool is_ok, const grpc::Status& status, ResponseType&& response) {
+            limiter->release(std::chrono::steady_clock::now() - started,
+                             is_dropped_(is_ok, status));
+            next(is_ok, status, std::move(response));
+         };
+      }
+
+      if(self.balancer) {
+         auto pick   = self.balancer->pick();
+         on_finished = [balancer = self.balancer, pick, next = std::move(on_finished)](
+                           bool is_ok, const grpc::Status& status, ResponseType&& response) {
+            balancer->record(pick, status.error_code() == grpc::StatusCode::UNAVAILABLE);
+            next(is_ok, status, std::move(response));
+         };
+         auto factory = [&self, &cq, service = pick.service](
+                            grpc::ClientContext& client_context) mutable {
+            apply_call_options(client_context, self.call_options, self.request);
+            return self.factory_fn(*service, &client_context, std::move(self.request), &cq);
+         };
+         return std::make_unique<InflightRpc<ResponseType>>(std::move(factory),
+                                                            std::move(on_finished));
+      }
+
+      auto factory = [&self, &cq](grpc::ClientContext& client_context) mutable {
+         apply_call_options(client_context, self.call_options, self.request);
+         return self.factory_fn(&client_context, std::move(self.request), &cq);
       };
 
       return std::make_unique<InflightRpc<ResponseType>>(std::move(factory),
-                                                         std::move(curried_completion));
+                                                         std::move(on_finished));
+   }
+
+   //!< Calls that show the backend is overloaded
+   static bool is_dropped_(bool is_ok, const grpc::Status& status) noexcept
+   {
+      const auto code = status.error_code();
+      return !is_ok || code == grpc::StatusCode::DEADLINE_EXCEEDED
+             || code == grpc::StatusCode::UNAVAILABLE
+             || code == grpc::StatusCode::RESOURCE_EXHAUSTED;
    }
 };
 
@@ -171,7 +313,7 @@ template<typename ReceiverType, typename ResultType> struct RpcSenderOpState
    void invoke() noexcept
    {
       const bool invoked = context_.post(call_factory_(
-          [this](bool is_ok, const grpc::Status& status, std::optional<ResultType> result) {
+          [this](bool is_ok, const grpc::Status& status, std::optional<ResultType>&& result) {
              if(!is_ok) {
                 stdexec::set_error(std::move(receiver_), RpcStatus{RpcStatusCode::Unavailable});
 
@@ -0,0 +1,28 @@
+
+#pragma once
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <string>
+
+namespace sgrpc::detail
+{
+
+/**
+ * Serializes a protobuf message such that equal messages produce equal bytes (i.e., map
+ * fields are ordered), which makes the result suitable as a key for caching/deduplication.
+ */
+template<typename MessageType> std::string serialize_deterministic(const MessageType& message)
+{
+   std::string bytes;
+   {
+      google::protobuf::io::StringOutputStream output{&bytes};
+      google::protobuf::io::CodedOutputStream coded_output{&output};
+      coded_output.SetSerializationDeterministic(true);
+      message.SerializeToCodedStream(&coded_output);
+   }
+   return bytes;
+}
+
+} // namespace sgrpc::detail
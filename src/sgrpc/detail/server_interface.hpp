@@ -18,6 +18,18 @@ class ServerContainerInterface
     * so that the execution context and process the events.
     */
    virtual std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& get_work_queues() = 0;
+
+   /**
+    * The work queues are split evenly (shard-major) between this many grpc servers; the
+    * execution context prefers to poll each thread's "own" shard, for cache locality.
+    */
+   virtual std::size_t number_shards() const noexcept { return 1; }
+
+   /**
+    * Shuts down the grpc server(s), so that no new rpcs start, and blocks until the rpcs in
+    * flight have finished; the work queues are left to the execution context.
+    */
+   virtual void shutdown() = 0;
 };
 
 } // namespace sgrpc
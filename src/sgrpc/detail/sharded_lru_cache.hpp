@@ -0,0 +1,194 @@
+
+#pragma once
+
+#include "../memory_budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cassert>
+
+namespace sgrpc::detail
+{
+
+struct LruCacheStats
+{
+   uint64_t hits{0};
+   uint64_t misses{0};
+   uint64_t evictions{0};   //!< Removed to make room
+   uint64_t expirations{0}; //!< Removed because the TTL expired
+   std::size_t entries{0};
+   std::size_t bytes{0}; //!< Approximate memory held by the cache
+
+   double hit_rate() const noexcept
+   {
+      const auto total = hits + misses;
+      return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+   }
+};
+
+/**
+ * @private
+ * @brief A lock-striped LRU cache with per-entry TTL and a global byte cap.
+ *
+ * Keys are hashed onto shards, and each shard has its own mutex, LRU list, and
+ * `max_bytes / number_shards` of the byte budget. Expired entries are evicted lazily,
+ * when found, or when they reach the cold end of the LRU list.
+ *
+ * With a `MemoryBudget`, entries are also charged against it, and are not cached (after
+ * making room) while it is spent.
+ *
+ * THREAD SAFE
+ */
+template<typename Value> class ShardedLruCache final
+{
+ public:
+   using clock_type = std::chrono::steady_clock;
+   using Stats      = LruCacheStats;
+
+   ShardedLruCache(std::size_t number_shards,
+                   std::size_t max_bytes,
+                   std::chrono::nanoseconds ttl,
+                   std::shared_ptr<MemoryBudget> budget = nullptr)
+       : shards_(std::max<std::size_t>(number_shards, 1))
+       , max_shard_bytes_{max_bytes / shards_.size()}
+       , ttl_{ttl}
+       , budget_{std::move(budget)}
+   {}
+
+   ShardedLruCache(const ShardedLruCache&)            = delete;
+   ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+   ~ShardedLruCache() { clear(); } // Gives back the budget
+
+   /**
+    * @return A copy of the value stored under `key`, if present and not expired.
+    */
+   std::optional<Value> find(std::string_view key)
+   {
+      auto& shard = shard_for_(key);
+      std::lock_guard lock{shard.padlock};
+      auto ii = shard.index.find(key);
+      if(ii == cend(shard.index)) {
+         ++shard.stats.misses;
+         return std::nullopt;
+      }
+
+      auto entry = ii->second;
+      if(entry->expires_at <= clock_type::now()) {
+         ++shard.stats.expirations;
+         ++shard.stats.misses;
+         erase_(shard, entry);
+         return std::nullopt;
+      }
+
+      ++shard.stats.hits;
+      shard.lru.splice(begin(shard.lru), shard.lru, entry); // Move to the hot end
+      return entry->value;
+   }
+
+   /**
+    * Inserts (or replaces) `key`, evicting cold entries until it fits in the shard.
+    * Values larger than a shard's byte budget are not cached.
+    */
+   void insert(std::string key, Value value, std::size_t value_bytes)
+   {
+      const auto bytes = value_bytes + key.size() + k_entry_overhead;
+      auto& shard      = shard_for_(key);
+      if(bytes > max_shard_bytes_) return;
+
+      std::lock_guard lock{shard.padlock};
+      if(auto ii = shard.index.find(key); ii != cend(shard.index)) erase_(shard, ii->second);
+
+      const auto now = clock_type::now();
+      while(!shard.lru.empty() && shard.stats.bytes + bytes > max_shard_bytes_) {
+         auto cold = std::prev(end(shard.lru));
+         ++(cold->expires_at <= now ? shard.stats.expirations : shard.stats.evictions);
+         erase_(shard, cold);
+      }
+      if(budget_ && !budget_->try_reserve(bytes)) return;
+
+      shard.lru.push_front(Entry{std::move(key), std::move(value), bytes, now + ttl_});
+      shard.index.emplace(shard.lru.front().key, begin(shard.lru));
+      shard.stats.bytes += bytes;
+      shard.stats.entries += 1;
+   }
+
+   void clear()
+   {
+      for(auto& shard : shards_) {
+         std::lock_guard lock{shard.padlock};
+         if(budget_) budget_->release(shard.stats.bytes);
+         shard.index.clear();
+         shard.lru.clear();
+         shard.stats.bytes   = 0;
+         shard.stats.entries = 0;
+      }
+   }
+
+   Stats stats() const
+   {
+      Stats result;
+      for(const auto& shard : shards_) {
+         std::lock_guard lock{shard.padlock};
+         result.hits += shard.stats.hits;
+         result.misses += shard.stats.misses;
+         result.evictions += shard.stats.evictions;
+         result.expirations += shard.stats.expirations;
+         result.entries += shard.stats.entries;
+         result.bytes += shard.stats.bytes;
+      }
+      return result;
+   }
+
+ private:
+   //!< Rough cost of the list node, index node, and bookkeeping for one entry
+   static constexpr std::size_t k_entry_overhead = sizeof(Value) + 8 * sizeof(void*);
+
+   struct Entry
+   {
+      std::string key;
+      Value value;
+      std::size_t bytes;
+      clock_type::time_point expires_at;
+   };
+   using EntryIterator = typename std::list<Entry>::iterator;
+
+   struct alignas(64) Shard
+   {
+      mutable std::mutex padlock;
+      std::list<Entry> lru; //!< Front is hot, back is cold
+      std::unordered_map<std::string_view, EntryIterator> index; //!< Keys view into `lru`
+      Stats stats;
+   };
+
+   Shard& shard_for_(std::string_view key)
+   {
+      return shards_[std::hash<std::string_view>{}(key) % shards_.size()];
+   }
+
+   void erase_(Shard& shard, EntryIterator entry)
+   {
+      assert(shard.stats.bytes >= entry->bytes);
+      if(budget_) budget_->release(entry->bytes);
+      shard.stats.bytes -= entry->bytes;
+      shard.stats.entries -= 1;
+      shard.index.erase(entry->key);
+      shard.lru.erase(entry);
+   }
+
+   std::vector<Shard> shards_;
+   const std::size_t max_shard_bytes_;
+   const std::chrono::nanoseconds ttl_;
+   std::shared_ptr<MemoryBudget> budget_; //!< Optional
+};
+
+} // namespace sgrpc::detail
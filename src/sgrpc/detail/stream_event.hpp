@@ -0,0 +1,33 @@
+
+#pragma once
+
+#include "completion_queue_event.hpp"
+
+namespace sgrpc::detail
+{
+
+/**
+ * A completion-queue tag that forwards to a member function of its owner.
+ *
+ * Streaming calls have several kinds of outstanding operation (start, read, write, finish),
+ * so the owner embeds one event per kind, and uses its address as the grpc tag. The owner
+ * manages its own lifecycle.
+ */
+template<typename Owner> class StreamEvent final : public CompletionQueueEvent
+{
+ public:
+   using Handler = void (Owner::*)(bool is_ok);
+
+   StreamEvent(Owner& owner, Handler handler)
+       : owner_{owner}
+       , handler_{handler}
+   {}
+
+   void complete(bool is_ok) noexcept override { (owner_.*handler_)(is_ok); }
+
+ private:
+   Owner& owner_;
+   Handler handler_;
+};
+
+} // namespace sgrpc::detail
@@ -0,0 +1,221 @@
+
+#pragma once
+
+#include "base_inc.hpp"
+
+#include "sgrpc/server_method_options.hpp"
+#include "sgrpc/execution_context.hpp"
+#include "sgrpc/scheduler.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace sgrpc::detail
+{
+/**
+ * What one unary server call does once its request is read, whichever backend serves it:
+ * answer from the response cache, or charge the memory budget, shed load, and run the
+ * logic according to `options.execution`; recording metrics throughout.
+ *
+ * `Call` derives from this class, and completes the call with its backend's primitives:
+ * ~~~
+ * static constexpr bool is_raw_;                        // Does it write serialized responses?
+ * void write_response_(const ResponseType& response);   // Finishes with `response`, if not raw
+ * void write_serialized_(grpc::ByteBuffer&& response);  // Finishes with `response`, if raw
+ * void finish_with_error_(const grpc::Status& status);  // Finishes with `status`
+ * const std::string& method_name_() const;              // The full method name, if raw
+ * ~~~
+ * Exactly one of the `write`/`finish` functions is called per call, after which the call may
+ * already be reused or deleted. Only raw calls use the response cache: a response is
+ * serialized once, for both the cache and the wire, and a hit is written as it is.
+ */
+template<typename Call,
+         typename ServerContext,
+         typename RequestType,
+         typename ResponseType,
+         typename RpcLogic>
+class UnaryCall
+{
+ protected:
+   using LogicResultType
+       = std::invoke_result_t<RpcLogic&, const ServerContext&, const RequestType&>;
+
+   //!< A call arrived, before its request is read
+   void arrive_(const ServerMethodOptions& options) noexcept
+   {
+      recorder_.arrive(options.metrics.get());
+   }
+
+   //!< Answers `request_`; the arguments must outlive the call
+   void dispatch_(ServerContext& server_context,
+                  RpcLogic& logic,
+                  const ServerMethodOptions& options,
+                  Scheduler scheduler)
+   {
+      bound_.emplace(server_context, logic, options, scheduler);
+
+      // Answer from the cache, without running any logic
+      if constexpr(Call::is_raw_) {
+         if(options.cache) {
+            cache_key_ = ServerResponseCache::make_key(
+                static_cast<const Call&>(*this).method_name_(), request_);
+            if(auto response = options.cache->find(cache_key_)) {
+               respond_(std::move(*response));
+               return;
+            }
+         }
+      }
+
+      // Reject, rather than run out of memory
+      if(options.memory_budget
+         && !reservation_.try_acquire(*options.memory_budget,
+                                      sizeof(Call) + request_.ByteSizeLong())) {
+         fail_(grpc::Status{grpc::StatusCode::RESOURCE_EXHAUSTED, "memory budget exhausted"});
+         return;
+      }
+
+      // Shed load before any logic runs
+      arrived_ = std::chrono::steady_clock::now();
+      if(options.admission && !options.admission->admit()) {
+         fail_(grpc::Status{grpc::StatusCode::RESOURCE_EXHAUSTED, "server overloaded"});
+         return;
+      }
+
+      // This is "immediate-mode" logic
+      constexpr bool is_executed_immediately = !stdexec::sender<LogicResultType>;
+      if constexpr(is_executed_immediately) {
+         if(options.execution != ExecutionPolicy::Offload) {
+            run_logic_();
+         } else if(!execution_scheduler_().context().post([this]() { run_logic_(); })) {
+            fail_(grpc::Status{grpc::StatusCode::UNAVAILABLE, "server shutting down"});
+         }
+
+      } else if(options.execution == ExecutionPolicy::Inline) {
+         start_logic_(stdexec::just()); // Starts on this thread
+      } else {
+         start_logic_(stdexec::schedule(execution_scheduler_())); // Execute on the scheduler
+      }
+   }
+
+   void fail_(const grpc::Status& status)
+   {
+      recorder_.finish(status.error_code());
+      static_cast<Call&>(*this).finish_with_error_(status);
+   }
+
+   //!< Before the call is reused for another request
+   void reset_() noexcept
+   {
+      reservation_.reset();
+      bound_.reset();
+   }
+
+   RequestType request_;
+
+ private:
+   struct Bound
+   {
+      ServerContext& server_context;
+      RpcLogic& logic;
+      const ServerMethodOptions& options;
+      Scheduler scheduler;
+   };
+
+   Scheduler execution_scheduler_() const noexcept
+   {
+      return bound_->options.offload_to != nullptr ? Scheduler{*bound_->options.offload_to}
+                                                   : bound_->scheduler;
+   }
+
+   //!< Immediate-mode logic
+   void run_logic_() noexcept
+   {
+      record_delay_();
+      try {
+         finish_(bound_->logic(bound_->server_context, request_));
+      } catch(...) {
+         // TODO: log here
+         fail_(grpc::Status{grpc::StatusCode::INTERNAL, ""});
+      }
+   }
+
+   //!< Sender logic, started from `head`
+   template<typename Sender> void start_logic_(Sender&& head)
+   {
+      stdexec::sender auto work
+          = std::forward<Sender>(head)
+            | stdexec::then([this]() { record_delay_(); })                // Queueing delay
+            | bound_->logic(bound_->server_context, request_)              // The specified logic
+            | stdexec::then([this](const ResponseType& response) { // Write response
+                 finish_(response);
+              })
+            | stdexec::upon_error([this](auto... arg) { // Handle errors
+                 // auto status = grpc::Status{
+                 //     detail::to_grpc_status_code(status.error_code()),
+                 //     std::string{std::cbegin(status.details()),
+                 //     std::cend(status.details())}};
+                 auto grpc_status = grpc::Status{grpc::StatusCode::UNKNOWN, "TBA"};
+                 fail_(grpc_status);
+              });
+
+      // Action!
+      stdexec::start_detached(work);
+   }
+
+   void record_delay_() noexcept
+   {
+      recorder_.start_logic();
+      if(bound_->options.admission)
+         bound_->options.admission->record(std::chrono::steady_clock::now() - arrived_);
+   }
+
+   void finish_(const ResponseType& response)
+   {
+      if constexpr(!Call::is_raw_) {
+         respond_(response);
+      } else {
+         // Serialized once, for both the cache and the wire
+         grpc::ByteBuffer serialized;
+         bool is_own_buffer = false;
+         const auto status  = grpc::SerializationTraits<ResponseType>::Serialize(
+             response, &serialized, &is_own_buffer);
+         if(!status.ok()) {
+            fail_(status);
+            return;
+         }
+         if(bound_->options.cache)
+            bound_->options.cache->insert(std::move(cache_key_), serialized); // Shares slices
+         respond_(std::move(serialized));
+      }
+   }
+
+   void respond_(const ResponseType& response)
+   {
+      prepare_response_(response.ByteSizeLong());
+      static_cast<Call&>(*this).write_response_(response);
+   }
+
+   void respond_(grpc::ByteBuffer&& response)
+   {
+      prepare_response_(response.Length());
+      static_cast<Call&>(*this).write_serialized_(std::move(response));
+   }
+
+   void prepare_response_(std::size_t response_bytes)
+   {
+      reservation_.grow(response_bytes); // Held by grpc until the call finishes
+      apply_method_options(bound_->server_context, bound_->options, response_bytes);
+      recorder_.finish(grpc::StatusCode::OK);
+   }
+
+   std::optional<Bound> bound_; //!< While answering a request
+   std::string cache_key_;      //!< Of the request, if caching
+   std::chrono::steady_clock::time_point arrived_;
+   MemoryReservation reservation_; //!< Against `options.memory_budget`, if any
+   CallRecorder recorder_;         //!< For `options.metrics`, if any
+};
+} // namespace sgrpc::detail
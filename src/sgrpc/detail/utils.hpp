@@ -1,21 +1,29 @@
 
 #pragma once
 
+#include "sgrpc/rpc_status.hpp"
 #include "sgrpc/rpc_status_code.hpp"
 
 #include <grpcpp/completion_queue.h>
 #include <grpcpp/support/status.h>
 
 #include <chrono>
+#include <exception>
+#include <optional>
+#include <string>
+#include <type_traits>
 
 namespace sgrpc::detail
 {
+/**
+ * A relative timeout; grpc adds a `GPR_TIMESPAN` to "now" when setting alarms and deadlines
+ */
 inline gpr_timespec duration_to_grp_timespec(std::chrono::nanoseconds delta)
 {
    gpr_timespec timeout_gpr;
    const auto seconds     = std::chrono::duration_cast<std::chrono::seconds>(delta);
    const auto nanos       = delta - seconds;
-   timeout_gpr.clock_type = GPR_CLOCK_MONOTONIC;
+   timeout_gpr.clock_type = GPR_TIMESPAN;
    timeout_gpr.tv_sec     = seconds.count();
    timeout_gpr.tv_nsec    = nanos.count();
    return timeout_gpr;
@@ -71,4 +79,51 @@ inline grpc::StatusCode to_grpc_status_code(RpcStatusCode code)
    return grpc::StatusCode::UNKNOWN;
 }
 
+//@{ The status code of an error delivered by a sender; `nullopt` if it isn't an rpc error
+inline std::optional<RpcStatusCode> status_code_of(const RpcStatus& status)
+{
+   return status.error_code();
+}
+
+inline std::optional<RpcStatusCode> status_code_of(const grpc::Status& status)
+{
+   return to_rpc_status_code(status.error_code());
+}
+
+template<typename Error> std::optional<RpcStatusCode> status_code_of(const Error&)
+{
+   return std::nullopt;
+}
+//@}
+
+//@{ The status to finish a call with, for an error delivered by a sender
+inline grpc::Status to_grpc_status(const grpc::Status& status) { return status; }
+
+inline grpc::Status to_grpc_status(const RpcStatus& status)
+{
+   return grpc::Status{to_grpc_status_code(status.error_code()), std::string{status.details()}};
+}
+
+//!< As for logic that throws: the exception's message isn't leaked to the client
+inline grpc::Status to_grpc_status(const std::exception_ptr&)
+{
+   return grpc::Status{grpc::StatusCode::INTERNAL, ""};
+}
+
+template<typename Error> grpc::Status to_grpc_status(const Error&)
+{
+   return grpc::Status{grpc::StatusCode::UNKNOWN, ""};
+}
+//@}
+
+/**
+ * Converts to the result of `fn()`, so that `std::optional::emplace` can construct
+ * immovable types (e.g., operation states) in place via guaranteed copy elision.
+ */
+template<typename Fn> struct EmplaceFrom
+{
+   Fn fn;
+   operator std::invoke_result_t<Fn&>() && { return fn(); }
+};
+
 } // namespace sgrpc::detail
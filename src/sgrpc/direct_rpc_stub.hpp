@@ -0,0 +1,141 @@
+
+#pragma once
+
+#include "detail/utils.hpp"
+
+#include "call_options.hpp"
+#include "rpc_sender.hpp"
+#include "scheduler.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace sgrpc
+{
+
+/**
+ * The client side of a unary method whose server lives in the same process: the method's
+ * logic (as bound for a `ServerRpcHandler`, e.g., with `bind_logic`) is called directly on
+ * the `ExecutionContext`, and the response is handed over without being serialized. There is
+ * no channel, completion queue, or grpc call at all.
+ *
+ * The senders are the same type-erased `ClientRpcSender`s as `ClientRpcStub::call` returns,
+ * so the two stubs can be swapped behind an interface. The server logic is passed an empty
+ * `grpc::ServerContext`: no metadata or deadline reach it, and `ServerMethodOptions` (cache,
+ * admission, etc.) do not apply. Use an in-process channel where those matter.
+ *
+ * ~~~
+ * auto stub = make_direct_rpc_stub<HelloRequest, HelloReply>(
+ *     bind_logic(*server, &Server::say_hello));
+ * auto sender = stub.call<std::string, ConvertResult>(context, request);
+ * ~~~
+ */
+template<typename RequestType, typename ResponseType, typename RpcLogic> class DirectRpcStub
+{
+ private:
+   using LogicResultType = std::invoke_result_t<RpcLogic&,
+                                                const grpc::ServerContextBase&,
+                                                const RequestType&>;
+
+   struct CallData
+   {
+      grpc::ServerContext server_context;
+      RequestType request;
+   };
+
+ public:
+   explicit DirectRpcStub(RpcLogic logic)
+       : logic_{std::make_shared<RpcLogic>(std::move(logic))}
+   {}
+
+   //!< `options` is accepted for parity with the other stubs; it only affects the transport
+   template<typename ResultType, typename ConversionFunction>
+   ClientRpcSender<ResultType>
+   call(sgrpc::ExecutionContext& context, RequestType request, ClientCallOptions = {})
+   {
+      WrappedRpcFactory<ResultType> factory
+          = [&context, logic = logic_, request = std::move(request)](
+                WrappedCompletionHandler<ResultType> completion) -> RpcFactory {
+         return [&context, logic, request, completion = std::move(completion)](
+                    grpc::CompletionQueue&) -> std::unique_ptr<CompletionQueueEvent> {
+            auto call     = std::make_shared<CallData>();
+            call->request = request; // Copied, so that the sender may be re-issued
+            if(!context.post([&context, logic, call, completion]() {
+                  run_<ResultType, ConversionFunction>(context, *logic, call, completion);
+               }))
+               completion(false, grpc::Status::CANCELLED, {}); // Shutting down
+            return nullptr; // No completion queue event
+         };
+      };
+
+      return {context, std::move(factory)};
+   }
+
+ private:
+   //!< Called on the context, like a `ServerRpcHandler`'s logic (with the `Default` policy)
+   template<typename ResultType, typename ConversionFunction>
+   static void run_(sgrpc::ExecutionContext& context,
+                    RpcLogic& logic,
+                    std::shared_ptr<CallData> call,
+                    WrappedCompletionHandler<ResultType> completion)
+   {
+      constexpr bool is_executed_immediately = !stdexec::sender<LogicResultType>;
+      if constexpr(is_executed_immediately) {
+         std::optional<ResponseType> response;
+         try {
+            response.emplace(logic(call->server_context, call->request));
+         } catch(...) {
+            completion(true, grpc::Status{grpc::StatusCode::INTERNAL, ""}, {});
+            return;
+         }
+         complete_<ResultType, ConversionFunction>(completion, std::move(*response));
+
+      } else {
+         stdexec::sender auto work
+             = stdexec::schedule(Scheduler{context})
+               | logic(call->server_context, call->request)
+               | stdexec::then([call, completion](ResponseType response) { // Moved, if it can be
+                    complete_<ResultType, ConversionFunction>(completion, std::move(response));
+                 })
+               | stdexec::upon_error([completion](const auto& error) {
+                    completion(true, detail::to_grpc_status(error), {});
+                 })
+               | stdexec::upon_stopped(
+                   [completion]() { completion(true, grpc::Status::CANCELLED, {}); });
+         stdexec::start_detached(std::move(work));
+      }
+   }
+
+   template<typename ResultType, typename ConversionFunction>
+   static void complete_(const WrappedCompletionHandler<ResultType>& completion,
+                         ResponseType&& response)
+   {
+      try {
+         ConversionFunction convert;
+         completion(
+             true, grpc::Status::OK, std::optional<ResultType>{convert(std::move(response))});
+      } catch(std::exception& e) {
+         completion(true,
+                    grpc::Status{grpc::StatusCode::INTERNAL,
+                                 fmt::format("exception unpacking protobuf, {}", e.what())},
+                    {});
+      } catch(...) {
+         completion(
+             true, grpc::Status{grpc::StatusCode::INTERNAL, "exception unpacking protobuf"}, {});
+      }
+   }
+
+   std::shared_ptr<RpcLogic> logic_; //!< Shared by in-flight calls
+};
+
+//!< Deduces the logic type; e.g., `make_direct_rpc_stub<Req, Resp>(bind_logic(...))`
+template<typename RequestType, typename ResponseType, typename RpcLogic>
+DirectRpcStub<RequestType, ResponseType, RpcLogic> make_direct_rpc_stub(RpcLogic logic)
+{
+   return DirectRpcStub<RequestType, ResponseType, RpcLogic>{std::move(logic)};
+}
+
+} // namespace sgrpc
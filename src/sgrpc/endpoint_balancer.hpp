@@ -0,0 +1,229 @@
+
+#pragma once
+
+#include "socket_address.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sgrpc
+{
+
+struct EndpointBalancerOptions
+{
+   double latency_smoothing{0.2};      //!< Weight of each new sample in the EWMA, in (0, 1]
+   //!< The latency sample of an `Unavailable` call (if it took less); a dead endpoint fails
+   //!< fast, and would otherwise look like the fastest
+   std::chrono::milliseconds unavailable_latency{100};
+   uint32_t eject_after_unavailable{5}; //!< Consecutive `Unavailable`s before ejection
+   std::chrono::milliseconds base_ejection_time{1000}; //!< Doubles on each re-ejection
+   std::chrono::milliseconds max_ejection_time{30000};
+   std::shared_ptr<grpc::ChannelCredentials> credentials{grpc::InsecureChannelCredentials()};
+};
+
+struct EndpointStats
+{
+   std::string address;
+   std::size_t outstanding{0};
+   std::chrono::nanoseconds latency_ewma{0};
+   uint64_t calls{0};
+   bool is_ejected{false};
+};
+
+/**
+ * Holds a channel (and grpc service stub) to each of a list of endpoints, and picks one
+ * for each call with "power of two choices": of two endpoints picked at random, the one
+ * with the lower `(outstanding + 1) * latency_ewma` wins.
+ *
+ * A call that fails with `Unavailable` is penalized as a slow call, and endpoints that keep
+ * failing are ejected for a while (with exponential backoff), unless that would leave no
+ * endpoint at all.
+ *
+ * ~~~
+ * auto balancer = std::make_shared<EndpointBalancer<Greeter::Stub>>(addresses);
+ * ClientRpcStub<Greeter::Stub, Request, Reply> stub{balancer, &Greeter::Stub::PrepareAsyncSay};
+ * ~~~
+ *
+ * THREAD SAFE
+ */
+template<typename Service> class EndpointBalancer final
+{
+ public:
+   using StubFactory = std::function<std::unique_ptr<Service>(std::shared_ptr<grpc::Channel>)>;
+
+   //!< A picked endpoint; pass back to `record` when the call completes
+   struct Pick
+   {
+      Service* service{nullptr};
+      std::size_t index{0};
+      std::chrono::steady_clock::time_point started;
+   };
+
+   explicit EndpointBalancer(
+       std::vector<std::string> addresses,
+       EndpointBalancerOptions options = {},
+       StubFactory stub_factory = [](std::shared_ptr<grpc::Channel> channel) {
+          return std::make_unique<Service>(std::move(channel));
+       })
+       : options_{std::move(options)}
+       , endpoints_(addresses.size())
+   {
+      if(addresses.empty()) throw std::invalid_argument{"requires at least 1 endpoint"};
+      for(std::size_t i = 0; i < addresses.size(); ++i) {
+         auto& endpoint   = endpoints_[i];
+         endpoint.address = std::move(addresses[i]);
+         endpoint.channel = make_channel(endpoint.address, options_.credentials);
+         endpoint.service = stub_factory(endpoint.channel);
+      }
+   }
+
+   std::size_t size() const noexcept { return endpoints_.size(); }
+
+   //!< The channel to each endpoint; e.g., to warm them up with `wait_until_ready`
+   std::vector<std::shared_ptr<grpc::Channel>> channels() const
+   {
+      std::vector<std::shared_ptr<grpc::Channel>> result;
+      result.reserve(endpoints_.size());
+      for(const auto& endpoint : endpoints_) result.push_back(endpoint.channel);
+      return result;
+   }
+
+   //!< Picks an endpoint for a call, and counts it as outstanding
+   Pick pick()
+   {
+      const auto now   = std::chrono::steady_clock::now();
+      const auto index = choose_(now);
+      auto& endpoint   = endpoints_[index];
+      endpoint.outstanding.fetch_add(1, std::memory_order_relaxed);
+      endpoint.calls.fetch_add(1, std::memory_order_relaxed);
+      return {endpoint.service.get(), index, now};
+   }
+
+   //!< Picks an endpoint without tracking the call; e.g., for calls that cannot report back
+   Service& any()
+   {
+      return *endpoints_[choose_(std::chrono::steady_clock::now())].service;
+   }
+
+   //!< Records the outcome of a call made through `pick()`
+   void record(const Pick& pick, bool is_unavailable)
+   {
+      const auto now = std::chrono::steady_clock::now();
+      auto& endpoint = endpoints_[pick.index];
+      endpoint.outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+      std::lock_guard lock{endpoint.padlock};
+      auto latency = now - pick.started;
+      if(is_unavailable)
+         latency = std::max<std::chrono::nanoseconds>(latency, options_.unavailable_latency);
+      const double sample = static_cast<double>(latency.count());
+      endpoint.latency_ewma = (endpoint.latency_ewma == 0.0)
+                                  ? sample
+                                  : endpoint.latency_ewma
+                                        + options_.latency_smoothing
+                                              * (sample - endpoint.latency_ewma);
+      if(!is_unavailable) {
+         endpoint.consecutive_unavailable = 0;
+         endpoint.ejections               = 0;
+         return;
+      }
+
+      if(++endpoint.consecutive_unavailable < options_.eject_after_unavailable) return;
+      endpoint.consecutive_unavailable = 0;
+      const auto backoff = std::min<std::chrono::nanoseconds>(
+          options_.base_ejection_time * (1ll << std::min(endpoint.ejections, 16u)),
+          options_.max_ejection_time);
+      endpoint.ejections += 1;
+      endpoint.ejected_until_ns.store((now + backoff).time_since_epoch().count(),
+                                      std::memory_order_relaxed);
+   }
+
+   std::vector<EndpointStats> stats() const
+   {
+      const auto now = std::chrono::steady_clock::now();
+      std::vector<EndpointStats> result;
+      result.reserve(endpoints_.size());
+      for(const auto& endpoint : endpoints_) {
+         std::lock_guard lock{endpoint.padlock};
+         result.push_back({endpoint.address,
+                           endpoint.outstanding.load(std::memory_order_relaxed),
+                           std::chrono::nanoseconds{
+                               static_cast<std::chrono::nanoseconds::rep>(endpoint.latency_ewma)},
+                           endpoint.calls.load(std::memory_order_relaxed),
+                           is_ejected_(endpoint, now)});
+      }
+      return result;
+   }
+
+ private:
+   struct Endpoint
+   {
+      std::string address;
+      std::shared_ptr<grpc::Channel> channel;
+      std::unique_ptr<Service> service;
+      std::atomic<std::size_t> outstanding{0};
+      std::atomic<uint64_t> calls{0};
+      std::atomic<int64_t> ejected_until_ns{0}; //!< steady_clock time since epoch
+
+      mutable std::mutex padlock;
+      double latency_ewma{0.0}; //!< Nanoseconds
+      uint32_t consecutive_unavailable{0};
+      uint32_t ejections{0}; //!< Since the last success
+   };
+
+   static bool is_ejected_(const Endpoint& endpoint, std::chrono::steady_clock::time_point now)
+   {
+      return endpoint.ejected_until_ns.load(std::memory_order_relaxed)
+             > now.time_since_epoch().count();
+   }
+
+   double score_(const Endpoint& endpoint) const
+   {
+      std::lock_guard lock{endpoint.padlock};
+      // Unmeasured endpoints score as the fastest, so that they get tried
+      const double latency = std::max(endpoint.latency_ewma, 1.0);
+      return static_cast<double>(endpoint.outstanding.load(std::memory_order_relaxed) + 1)
+             * latency;
+   }
+
+   std::size_t choose_(std::chrono::steady_clock::time_point now)
+   {
+      thread_local std::minstd_rand generator{std::random_device{}()};
+      const auto n = endpoints_.size();
+      if(n == 1) return 0;
+
+      // Sample two distinct endpoints, preferring ones that are not ejected
+      auto sample = [&](std::size_t exclude) {
+         std::size_t index = exclude;
+         for(int attempt = 0; attempt < 4; ++attempt) {
+            do {
+               index = std::uniform_int_distribution<std::size_t>{0, n - 1}(generator);
+            } while(index == exclude);
+            if(!is_ejected_(endpoints_[index], now)) break;
+         }
+         return index;
+      };
+      const auto a = sample(n); // `n` excludes nothing
+      const auto b = sample(a);
+
+      const bool a_ejected = is_ejected_(endpoints_[a], now);
+      const bool b_ejected = is_ejected_(endpoints_[b], now);
+      if(a_ejected != b_ejected) return a_ejected ? b : a;
+      return score_(endpoints_[a]) <= score_(endpoints_[b]) ? a : b;
+   }
+
+   const EndpointBalancerOptions options_;
+   std::vector<Endpoint> endpoints_;
+};
+
+} // namespace sgrpc
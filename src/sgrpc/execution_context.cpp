@@ -4,11 +4,16 @@
 #include "detail/alarm.hpp"
 #include "detail/utils.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <stdexcept>
 
 namespace sgrpc
 {
 
+//!< The context whose thread this is, if any
+static thread_local const ExecutionContext* tl_running_context_ = nullptr;
+
 // ------------------------------------------------------------------------ Construction/Destruction
 
 ExecutionContext::ExecutionContext(unsigned n_threads,
@@ -38,11 +43,52 @@ ExecutionContext::~ExecutionContext() { stop(); }
 void ExecutionContext::attach_server(std::shared_ptr<ServerContainerInterface> server)
 {
    std::lock_guard lock{padlock_};
-   if(get_state() != ExecutionState::Ready) {
+   if(get_state() > ExecutionState::Running) {
       throw std::runtime_error(
-          "attempt to attach a server to an already running execution-context");
+          "attempt to attach a server to a stopping or stopped execution-context");
+   }
+   auto servers = std::make_shared<ServerList>(*servers_);
+   servers->push_back(std::move(server));
+   servers_ = std::move(servers);
+   servers_version_.fetch_add(1, std::memory_order_release);
+}
+
+bool ExecutionContext::detach_server(const std::shared_ptr<ServerContainerInterface>& server)
+{
+   if(tl_running_context_ == this)
+      throw std::logic_error("cannot detach a server from the execution-context's own threads");
+
+   {
+      std::lock_guard lock{padlock_};
+      if(std::find(cbegin(*servers_), cend(*servers_), server) == cend(*servers_)) return false;
+      if(get_state() == ExecutionState::ShuttingDown) {
+         throw std::runtime_error(
+             "attempt to detach a server from a stopping execution-context");
+      }
    }
-   servers_.push_back(std::move(server));
+
+   // No new rpcs; those in flight finish on the context, which still polls the server
+   if(get_state() != ExecutionState::Stopped) server->shutdown();
+
+   {
+      std::lock_guard lock{padlock_};
+      auto servers = std::make_shared<ServerList>(*servers_);
+      auto ii      = std::find(cbegin(*servers), cend(*servers), server);
+      if(ii == cend(*servers)) return false; // Detached concurrently
+      servers->erase(ii);
+      servers_ = std::move(servers);
+      servers_version_.fetch_add(1, std::memory_order_release);
+   }
+
+   // Drain what's left. A context thread may still pull events too (it holds the old list
+   // until its next poll), which is fine: completion queues are thread safe.
+   for(auto& cq : server->get_work_queues()) {
+      cq->Shutdown();
+      void* tag  = nullptr;
+      bool is_ok = false;
+      while(cq->Next(&tag, &is_ok)) static_cast<CompletionQueueEvent*>(tag)->complete(is_ok);
+   }
+   return true;
 }
 
 // -- Post
@@ -76,17 +122,10 @@ bool ExecutionContext::post(DeadlinedThunkType thunk, std::chrono::nanoseconds d
 
 bool ExecutionContext::post(RpcFactory call_factory)
 {
-   within_cq_post_.fetch_add(1, std::memory_order_acq_rel);
-   std::atomic_signal_fence(std::memory_order_acq_rel); // Forbid reordering
-   bool can_post = get_state() <= ExecutionState::Running;
-
-   if(can_post) {
-      auto* event = call_factory(get_next_cq_()).release();
+   return post_to_cq([&call_factory](grpc::CompletionQueue& cq) {
+      auto* event = call_factory(cq).release();
       (void) event; // The event's lifecycle is managed by the completion queue.
-   }
-
-   within_cq_post_.fetch_sub(1, std::memory_order_acq_rel);
-   return can_post;
+   });
 }
 
 // -- Action!
@@ -127,8 +166,13 @@ void ExecutionContext::stop()
    while(within_cq_post_.load(std::memory_order_acquire) > 0) { std::this_thread::yield(); }
 
    // Halt queues
+   std::shared_ptr<const ServerList> servers;
+   {
+      std::lock_guard lock{padlock_};
+      servers = servers_;
+   }
    for(auto& cq : cqs_) cq->Shutdown();
-   for(auto& server : servers_)
+   for(auto& server : *servers)
       for(auto& cq : server->get_work_queues()) cq->Shutdown();
 
    // Join threads
@@ -192,7 +236,23 @@ void ExecutionContext::run_one_thread_(unsigned thread_number, std::function<boo
    bool is_ok = false;
    ThunkType thunk;
 
+   tl_running_context_ = this;
+   std::shared_ptr<const ServerList> servers;
+   uint64_t servers_version = 0;
+   {
+      std::lock_guard lock{padlock_};
+      servers         = servers_;
+      servers_version = servers_version_.load(std::memory_order_relaxed);
+   }
+
    while(true) {
+      // Pick up attached and detached servers; only takes the lock when they've changed
+      if(servers_version_.load(std::memory_order_acquire) != servers_version) {
+         std::lock_guard lock{padlock_};
+         servers         = servers_;
+         servers_version = servers_version_.load(std::memory_order_relaxed);
+      }
+
       if(predicate()) { // Predicate causes 'stop()' to happen
          stop();        // Which causes all thunks to drain
       }
@@ -202,12 +262,12 @@ void ExecutionContext::run_one_thread_(unsigned thread_number, std::function<boo
          uint32_t shutdown_cq_count     = 0;
          uint32_t total_cq_count        = 0;
 
-         auto run_completion_queues = [&](auto& cqs) {
+         auto run_completion_queues = [&](auto& cqs, std::size_t first_index) {
             // Try to run at least one thing from this set of queues
             total_cq_count += cqs.size();
             auto current_count = things_executed_count;
             for(auto i = 0u; i < cqs.size() && (current_count == things_executed_count); ++i) {
-               auto next_cq_index = (thread_number + i) % cqs.size();
+               auto next_cq_index = (first_index + i) % cqs.size();
                switch(execute_cq_(*cqs[next_cq_index])) {
                case CqExecutionResult::ExecutedNone: break;
                case CqExecutionResult::ExecutedOne: ++things_executed_count; break;
@@ -216,8 +276,16 @@ void ExecutionContext::run_one_thread_(unsigned thread_number, std::function<boo
             }
          };
 
-         run_completion_queues(cqs_);
-         for(auto& server : servers_) run_completion_queues(server->get_work_queues());
+         run_completion_queues(cqs_, thread_number);
+         for(auto& server : *servers) {
+            // Start with this thread's own shard, and only then help out the others
+            auto& cqs          = server->get_work_queues();
+            const auto shards  = std::max<std::size_t>(server->number_shards(), 1);
+            const auto per     = std::max<std::size_t>(cqs.size() / shards, 1);
+            const auto home    = thread_number % shards;
+            const auto in_home = (thread_number / shards) % per;
+            run_completion_queues(cqs, home * per + in_home);
+         }
 
          if(shutdown_cq_count == total_cq_count) {
             break; // switch to full shutdown mode
@@ -239,6 +307,8 @@ void ExecutionContext::run_one_thread_(unsigned thread_number, std::function<boo
       }
    }
 
+   servers.reset();
+
    // We're in shutdown mode... draing everything from `task_queue_`
    auto thunks = task_queue_.stop_and_eject();
    for(auto& thunk : thunks) {
@@ -246,6 +316,7 @@ void ExecutionContext::run_one_thread_(unsigned thread_number, std::function<boo
    }
 
    // And we're done
+   tl_running_context_ = nullptr;
 }
 
 ExecutionContext::CqExecutionResult ExecutionContext::execute_cq_(grpc::CompletionQueue& cq)
@@ -43,10 +43,22 @@ class ExecutionContext final
 
    //@{ Mutation
    /**
-    * This method must be called before `run()`. The attached server's lifetime is
-    * extended until after `stop()`.
+    * The context's threads poll the server's work queues from then on; this may be called
+    * before `run()`, or while running (e.g., to bring up a shard lazily). The attached
+    * server's lifetime is extended until after `stop()`, or `detach_server`.
     */
    void attach_server(std::shared_ptr<ServerContainerInterface> server);
+
+   /**
+    * Drains and detaches a server, e.g., to replace it while the context keeps running:
+    * shuts down its grpc server(s) (so new rpcs are refused, and rpcs in flight finish on
+    * the context, as usual), and then shuts down and drains its work queues. The context's
+    * threads drop their reference to the server at their next poll.
+    *
+    * Blocks until drained, so throws `std::logic_error` if called from one of the context's
+    * own threads. Returns `false` if the server was not attached.
+    */
+   bool detach_server(const std::shared_ptr<ServerContainerInterface>& server);
    //@}
 
    //@{ Posting events
@@ -54,6 +66,13 @@ class ExecutionContext final
    bool post(DeadlinedThunkType thunk, std::chrono::steady_clock::time_point deadline);
    bool post(DeadlinedThunkType thunk, std::chrono::nanoseconds delta);
    bool post(RpcFactory call_factory);
+
+   /**
+    * Like `post(RpcFactory)`, but without type-erasure: `fn(cq)` is called synchronously,
+    * and schedules its own events (whose lifecycle it manages) on `cq`. Returns `false`,
+    * without calling `fn`, if the context is shutting down.
+    */
+   template<typename Function> bool post_to_cq(Function&& fn);
    //@}
 
    //@{ Action!
@@ -72,12 +91,17 @@ class ExecutionContext final
    void run_one_thread_(unsigned thread_number, std::function<bool()> predicate);
    CqExecutionResult execute_cq_(grpc::CompletionQueue& cq);
 
+   using ServerList = std::vector<std::shared_ptr<ServerContainerInterface>>;
+
    //@{ Members
    mutable std::mutex padlock_;
    std::vector<std::thread> threads_;
    AtomicTaskStealingQueue<ThunkType> task_queue_; //!< For things not pushed onto cqs_
    std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs_;
-   std::vector<std::shared_ptr<ServerContainerInterface>> servers_;
+
+   //!< Copy on write, under `padlock_`; threads re-read it only when the version changes
+   std::shared_ptr<const ServerList> servers_{std::make_shared<const ServerList>()};
+   std::atomic<uint64_t> servers_version_{0};
 
    std::vector<ThunkType> notifications_; //!< For when stopped and drained
    std::atomic<ExecutionState> state_{ExecutionState::Ready};
@@ -87,4 +111,16 @@ class ExecutionContext final
    //@}
 };
 
+template<typename Function> bool ExecutionContext::post_to_cq(Function&& fn)
+{
+   within_cq_post_.fetch_add(1, std::memory_order_acq_rel);
+   std::atomic_signal_fence(std::memory_order_acq_rel); // Forbid reordering
+   bool can_post = get_state() <= ExecutionState::Running;
+
+   if(can_post) fn(get_next_cq_());
+
+   within_cq_post_.fetch_sub(1, std::memory_order_acq_rel);
+   return can_post;
+}
+
 } // namespace sgrpc
@@ -0,0 +1,341 @@
+
+#pragma once
+
+#include "detail/completion_queue_event.hpp"
+#include "detail/server_interface.hpp"
+
+#include "execution_context.hpp"
+#include "server_options.hpp"
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sgrpc
+{
+
+/**
+ * Calls whose method name (e.g., "/helloworld.Greeter/SayHello") starts with `prefix` are
+ * forwarded to `channel`. The longest matching prefix wins; an empty prefix matches all.
+ */
+struct ProxyRoute
+{
+   std::string prefix;
+   std::shared_ptr<grpc::Channel> channel;
+};
+
+struct ProxyOptions
+{
+   std::vector<ProxyRoute> routes;
+   std::size_t request_slots{1}; //!< Calls awaited concurrently, per completion queue
+   bool forward_metadata{true};  //!< Client metadata upstream; server metadata back down
+};
+
+namespace detail
+{
+   struct ProxyUpstream
+   {
+      std::string prefix;
+      grpc::GenericStub stub;
+   };
+
+   //!< Metadata that grpc sets itself, and so must not be forwarded
+   inline bool is_reserved_metadata(std::string_view key)
+   {
+      return key.starts_with(':') || key.starts_with("grpc-") || key == "user-agent"
+             || key == "content-type" || key == "te" || key == "host";
+   }
+
+   /**
+    * One forwarded call: the request and response stay as `grpc::ByteBuffer`s, so that
+    * nothing is parsed or re-serialized. The upstream call runs on the same completion queue
+    * as the downstream call, and is cancelled if the downstream call is (e.g., its client
+    * gives up). The handler deletes itself once the call is finished, and grpc has notified
+    * that it is done.
+    */
+   class ProxyCallHandler final : public CompletionQueueEvent
+   {
+    private:
+      enum class Stage : int { Requested, Reading, Draining, Forwarding, Finishing };
+
+    public:
+      ProxyCallHandler(grpc::AsyncGenericService& service,
+                       std::vector<ProxyUpstream>& upstreams,
+                       bool forward_metadata,
+                       grpc::ServerCompletionQueue& cq)
+          : service_{service}
+          , upstreams_{upstreams}
+          , forward_metadata_{forward_metadata}
+          , cq_{cq}
+          , stream_{&server_context_}
+          , done_{*this}
+      {
+         // Note: `this` lifecycle now controlled by the completion queue
+         server_context_.AsyncNotifyWhenDone(&done_); // Only delivered if the call starts
+         service_.RequestCall(&server_context_, &stream_, &cq_, &cq_, this);
+      }
+
+      void complete(bool is_ok) noexcept override
+      {
+         switch(stage_) {
+         case Stage::Requested:
+            if(!is_ok) { // Shutting down
+               delete this;
+               return;
+            }
+            new ProxyCallHandler{service_, upstreams_, forward_metadata_, cq_}; // Next call
+            route_();
+            break;
+
+         case Stage::Reading:
+            if(!is_ok) {
+               finish_(grpc::Status{grpc::StatusCode::INVALID_ARGUMENT, "missing request"});
+               return;
+            }
+            // A unary call half-closes after its request; any more messages => streaming
+            stage_ = Stage::Draining;
+            stream_.Read(&surplus_, this);
+            break;
+
+         case Stage::Draining:
+            if(is_ok) {
+               finish_(grpc::Status{grpc::StatusCode::UNIMPLEMENTED,
+                                    "streaming calls are not proxied"});
+               return;
+            }
+            forward_();
+            break;
+
+         case Stage::Forwarding: respond_(); break;
+
+         case Stage::Finishing: release_(); break;
+         }
+      }
+
+    private:
+      //!< Delivered once the downstream call is done, whether finished or cancelled
+      class DoneEvent final : public CompletionQueueEvent
+      {
+       public:
+         explicit DoneEvent(ProxyCallHandler& handler)
+             : handler_{handler}
+         {}
+
+         void complete(bool /* is_ok */) noexcept override { handler_.on_done_(); }
+
+       private:
+         ProxyCallHandler& handler_;
+      };
+
+      //!< May race the call's own events; `TryCancel` is thread safe
+      void on_done_() noexcept
+      {
+         if(server_context_.IsCancelled()) client_context_.TryCancel(); // Even before it starts
+         release_();
+      }
+
+      //!< Deletes `this` once both the call and the done notification are finished
+      void release_() noexcept
+      {
+         if(references_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+      }
+
+      void route_()
+      {
+         const auto& method = server_context_.method();
+         for(auto& upstream : upstreams_)
+            if(method.starts_with(upstream.prefix)) {
+               upstream_ = &upstream; // Sorted, so this is the longest match
+               break;
+            }
+         if(upstream_ == nullptr) {
+            finish_(grpc::Status{grpc::StatusCode::UNIMPLEMENTED, "no route for " + method});
+            return;
+         }
+         stage_ = Stage::Reading;
+         stream_.Read(&request_, this);
+      }
+
+      void forward_()
+      {
+         client_context_.set_deadline(server_context_.deadline());
+         if(forward_metadata_)
+            for(const auto& [key, value] : server_context_.client_metadata())
+               if(!is_reserved_metadata({key.data(), key.size()}))
+                  client_context_.AddMetadata(std::string{key.data(), key.size()},
+                                              std::string{value.data(), value.size()});
+
+         stage_ = Stage::Forwarding;
+         response_reader_ = upstream_->stub.PrepareUnaryCall(
+             &client_context_, server_context_.method(), request_, &cq_);
+         response_reader_->StartCall();
+         response_reader_->Finish(&response_, &upstream_status_, this);
+      }
+
+      void respond_()
+      {
+         if(forward_metadata_) {
+            for(const auto& [key, value] : client_context_.GetServerInitialMetadata())
+               if(!is_reserved_metadata({key.data(), key.size()}))
+                  server_context_.AddInitialMetadata(std::string{key.data(), key.size()},
+                                                     std::string{value.data(), value.size()});
+            for(const auto& [key, value] : client_context_.GetServerTrailingMetadata())
+               if(!is_reserved_metadata({key.data(), key.size()}))
+                  server_context_.AddTrailingMetadata(std::string{key.data(), key.size()},
+                                                      std::string{value.data(), value.size()});
+         }
+
+         if(!upstream_status_.ok()) {
+            finish_(upstream_status_);
+            return;
+         }
+         stage_ = Stage::Finishing;
+         stream_.WriteAndFinish(response_, grpc::WriteOptions{}, grpc::Status::OK, this);
+      }
+
+      void finish_(const grpc::Status& status)
+      {
+         stage_ = Stage::Finishing;
+         stream_.Finish(status, this);
+      }
+
+      grpc::AsyncGenericService& service_;
+      std::vector<ProxyUpstream>& upstreams_; //!< Thread safe stubs
+      const bool forward_metadata_;
+      grpc::ServerCompletionQueue& cq_;
+
+      Stage stage_{Stage::Requested};
+      grpc::GenericServerContext server_context_;
+      grpc::GenericServerAsyncReaderWriter stream_;
+      DoneEvent done_;
+      std::atomic<int> references_{2}; //!< The call's events, and `done_`
+      ProxyUpstream* upstream_{nullptr};
+
+      grpc::ClientContext client_context_;
+      std::unique_ptr<grpc::GenericClientAsyncResponseReader> response_reader_;
+      grpc::ByteBuffer request_;
+      grpc::ByteBuffer surplus_; //!< A second request message, if any, which is never forwarded
+      grpc::ByteBuffer response_;
+      grpc::Status upstream_status_;
+   };
+} // namespace detail
+
+/**
+ * An L7 proxy: serves every method, and forwards each call, as raw bytes, to the upstream
+ * channel routed by method name, along with its deadline and metadata.
+ *
+ * Only unary methods are forwarded. A call whose client sends more than one message is
+ * answered with `UNIMPLEMENTED` instead, once its client sends the second message; so a
+ * client that awaits a response before half-closing waits until its deadline. Calls to
+ * server streaming methods look unary to the proxy, and fail upstream.
+ *
+ * ~~~
+ * auto proxy = sgrpc::GenericProxyContainer::make(
+ *     context,
+ *     sgrpc::ProxyOptions{.routes = {{"/helloworld.Greeter/", greeter_channel}}},
+ *     sgrpc::ServerOptions{.number_work_queues = 4, .port = 50051});
+ * context.run();
+ * ~~~
+ */
+class GenericProxyContainer : public ServerContainerInterface
+{
+ public:
+   static std::shared_ptr<GenericProxyContainer> make(ExecutionContext& execution_context,
+                                                      ProxyOptions proxy_options,
+                                                      ServerOptions options) noexcept(false)
+   {
+      auto container = std::make_shared<GenericProxyContainer>();
+      container->init(std::move(proxy_options), std::move(options));
+
+      // Attach to the execution context... so that the container lives until then
+      // execution context is stopped.
+      execution_context.attach_server(container);
+
+      return container;
+   }
+
+   //@{ Getters
+   uint16_t port() const { return port_; } //!< Zero when listening on a unix socket
+   const std::string& address() const { return address_; } //!< Where local clients connect
+   grpc::Server& grpc_server() { return *grpc_server_; }
+   //@}
+
+   //!< A channel to the server that skips the network stack (messages are still serialized);
+   //!< for clients in this process, with the same rpc semantics as a network channel
+   std::shared_ptr<grpc::Channel> in_process_channel(grpc::ChannelArguments arguments = {})
+   {
+      return grpc_server_->InProcessChannel(arguments);
+   }
+
+   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& get_work_queues() override
+   {
+      return cqs_;
+   }
+
+   void shutdown() override
+   {
+      grpc_server_->Shutdown();
+      grpc_server_->Wait();
+   }
+
+ private:
+   void init(ProxyOptions proxy_options, ServerOptions options)
+   {
+      if(options.number_work_queues == 0)
+         throw std::invalid_argument{"requires at least 1 work queue"};
+      if(proxy_options.routes.empty()) throw std::invalid_argument{"requires at least 1 route"};
+
+      // Longest prefix first, so that the first match is the best
+      std::sort(begin(proxy_options.routes),
+                end(proxy_options.routes),
+                [](const auto& a, const auto& b) { return a.prefix.size() > b.prefix.size(); });
+      upstreams_.reserve(proxy_options.routes.size());
+      for(auto& route : proxy_options.routes)
+         upstreams_.push_back({std::move(route.prefix), grpc::GenericStub{route.channel}});
+
+      grpc::ServerBuilder builder;
+
+      // Set the listening port (and defaults) for this server
+      int selected_port = 0;
+      socket_file_      = detail::UnixSocketFile{options.address};
+      detail::apply_server_options(builder, options, &selected_port);
+
+      // Every method is handled generically
+      builder.RegisterAsyncGenericService(&service_);
+
+      // Create the work queues
+      cqs_.reserve(options.number_work_queues);
+      for(auto i = 0u; i < options.number_work_queues; ++i)
+         cqs_.push_back(builder.AddCompletionQueue());
+
+      // Assemble the server.
+      grpc_server_ = builder.BuildAndStart();
+      if(grpc_server_ == nullptr) throw std::runtime_error{"failed to start server"};
+      port_    = detail::is_tcp(options) ? static_cast<uint16_t>(selected_port) : 0;
+      address_ = detail::local_address(options, port_);
+
+      // Await calls on the server completion queues
+      for(auto& cq : cqs_)
+         for(std::size_t i = 0; i < std::max<std::size_t>(proxy_options.request_slots, 1); ++i)
+            new detail::ProxyCallHandler{
+                service_, upstreams_, proxy_options.forward_metadata, *cq};
+   }
+
+   detail::UnixSocketFile socket_file_; //!< Removed after the server is destroyed
+   grpc::AsyncGenericService service_;
+   std::vector<detail::ProxyUpstream> upstreams_;
+   std::unique_ptr<grpc::Server> grpc_server_;
+   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+   uint16_t port_{0};
+   std::string address_;
+};
+
+} // namespace sgrpc
@@ -3,9 +3,16 @@
 
 #include "execution_context.hpp"
 #include "scheduler.hpp"
+#include "server_options.hpp"
 
 #include <fmt/format.h>
 
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace sgrpc
 {
 
@@ -21,14 +28,24 @@ class GenericServerContainer : public ServerContainerInterface
        uint16_t port               = 0,
        std::shared_ptr<grpc::ServerCredentials> credentials
        = grpc::InsecureServerCredentials()) noexcept(false)
+   {
+      return make(execution_context,
+                  std::move(server),
+                  std::move(wire_rpcs),
+                  ServerOptions{.number_work_queues = number_work_queues,
+                                .port               = port,
+                                .credentials        = std::move(credentials)});
+   }
+
+   static std::shared_ptr<GenericServerContainer> make(
+       ExecutionContext& execution_context,
+       std::shared_ptr<Server> server,
+       std::function<void(Server&, Service&, Scheduler, grpc::ServerCompletionQueue& cq)> wire_rpcs,
+       ServerOptions options) noexcept(false)
    {
       auto container = std::make_shared<GenericServerContainer>();
-      container->init(execution_context,
-                      std::move(server),
-                      std::move(wire_rpcs),
-                      number_work_queues,
-                      port,
-                      std::move(credentials));
+      container->init(
+          execution_context, std::move(server), std::move(wire_rpcs), std::move(options));
 
       // Attach to the execution context... so that the container lives until then
       // execution context is stopped.
@@ -38,62 +55,114 @@ class GenericServerContainer : public ServerContainerInterface
    }
 
    //@{ Getters
-   uint16_t port() const { return port_; }
-   Service& service() { return service_; }
+   uint16_t port() const { return port_; } //!< Zero when listening on a unix socket
+   const std::string& address() const { return address_; } //!< Where local clients connect
+   Service& service(std::size_t shard = 0) { return *shards_.at(shard).service; }
    Server& server() { return *server_; }
-   grpc::Server& grpc_server() { return *grpc_server_; }
+   grpc::Server& grpc_server(std::size_t shard = 0) { return *shards_.at(shard).grpc_server; }
+   std::size_t number_shards() const noexcept override { return shards_.size(); }
    //@}
 
+   //!< A channel to the server that skips the network stack (messages are still serialized);
+   //!< for clients in this process, with the same rpc semantics as a network channel
+   std::shared_ptr<grpc::Channel> in_process_channel(grpc::ChannelArguments arguments = {})
+   {
+      return shards_.front().grpc_server->InProcessChannel(arguments);
+   }
+
    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& get_work_queues() override
    {
       return cqs_;
    }
 
+   void shutdown() override
+   {
+      for(auto& shard : shards_) shard.grpc_server->Shutdown();
+      for(auto& shard : shards_) shard.grpc_server->Wait();
+   }
+
  private:
    void init(
        ExecutionContext& execution_context,
        std::shared_ptr<Server> server,
        std::function<void(Server&, Service&, Scheduler, grpc::ServerCompletionQueue& cq)> wire_rpcs,
-       uint32_t number_work_queues,
-       uint16_t port,
-       std::shared_ptr<grpc::ServerCredentials> credentials)
+       ServerOptions options)
    {
+      const auto number_work_queues = options.number_work_queues;
+      const auto number_shards      = options.number_shards;
+
       // if port is zero, then what?
       if(number_work_queues == 0) throw std::invalid_argument{"requires at least 1 work queue"};
-
-      // Take control of the server instance
-      server_ = std::move(server);
-
-      grpc::ServerBuilder builder;
-
-      // Set the listening port for this server
-      std::string server_address(fmt::format("0.0.0.0:{}", port));
-      int selected_port = static_cast<int>(port);
-      builder.AddListeningPort(server_address, std::move(credentials), &selected_port);
-
-      // The instance through which RPCs are handled
-      builder.RegisterService(&service_);
-
-      // Create the work queues
-      cqs_.reserve(number_work_queues);
-      for(auto i = 0u; i < number_work_queues; ++i) cqs_.push_back(builder.AddCompletionQueue());
-
-      // Assemble the server.
-      grpc_server_ = builder.BuildAndStart();
-
-      // What port did we get?
-      if(port_ == 0) port_ = static_cast<uint16_t>(selected_port);
-      assert(port_ == static_cast<uint16_t>(selected_port));
+      if(number_shards == 0) throw std::invalid_argument{"requires at least 1 shard"};
+      if(number_shards > 1 && !detail::is_tcp(options))
+         throw std::invalid_argument{"shards require a tcp address"};
+
+      // Clear out any stale socket file before binding
+      socket_file_ = detail::UnixSocketFile{options.address};
+
+      // Take control of the server instance, and any extra services
+      server_   = std::move(server);
+      services_ = std::move(options.services);
+
+      // One grpc server per shard, all listening on the same port, so that the kernel
+      // spreads connections across them (SO_REUSEPORT). Work queues are shard-major.
+      shards_.resize(number_shards);
+      cqs_.reserve(number_shards * number_work_queues);
+      for(auto& shard : shards_) {
+         grpc::ServerBuilder builder;
+
+         // Set the listening port (and defaults) for this server; the first shard picks
+         // the port if none was given, and the others bind the same one
+         int selected_port = 0;
+         if(port_ != 0) {
+            options.port = port_;
+            if(!options.address.empty())
+               options.address = detail::with_port(options.address, port_);
+         }
+         detail::apply_server_options(builder, options, &selected_port);
+         if(number_shards > 1) builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT, 1);
+
+         // The instance through which RPCs are handled
+         shard.service = std::make_unique<Service>();
+         builder.RegisterService(shard.service.get());
+         for(const auto& service : services_) builder.RegisterService(service.get());
+
+         // Create the work queues
+         for(auto i = 0u; i < number_work_queues; ++i)
+            cqs_.push_back(builder.AddCompletionQueue());
+
+         // Assemble the server.
+         shard.grpc_server = builder.BuildAndStart();
+         if(shard.grpc_server == nullptr) throw std::runtime_error{"failed to start server"};
+
+         // What port did we get?
+         if(port_ == 0) port_ = static_cast<uint16_t>(selected_port);
+         assert(port_ == static_cast<uint16_t>(selected_port));
+      }
+      if(!detail::is_tcp(options)) port_ = 0;
+      address_ = detail::local_address(options, port_);
 
       // Register RPC callbacks onto the server completion queues
-      for(auto& cq : cqs_) wire_rpcs(*server_, service_, sgrpc::Scheduler{execution_context}, *cq);
+      for(std::size_t i = 0; i < cqs_.size(); ++i)
+         wire_rpcs(*server_,
+                   *shards_[i / number_work_queues].service,
+                   sgrpc::Scheduler{execution_context},
+                   *cqs_[i]);
    }
 
-   Service service_;                           //!< grpc generated code
-   std::unique_ptr<grpc::Server> grpc_server_; //!< The grpc server
-   std::shared_ptr<Server> server_;            //!< The application code server
+   struct Shard
+   {
+      std::unique_ptr<Service> service;          //!< grpc generated code
+      std::unique_ptr<grpc::Server> grpc_server; //!< The grpc server
+   };
+
+   detail::UnixSocketFile socket_file_; //!< Removed after the servers are destroyed
+   std::vector<std::shared_ptr<grpc::Service>> services_; //!< Outlive the servers
+   std::vector<Shard> shards_;
+   std::shared_ptr<Server> server_; //!< The application code server
    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
    uint16_t port_{0};
+   std::string address_;
 };
 
 } // namespace sgrpc
@@ -0,0 +1,155 @@
+
+#pragma once
+
+#include <grpcpp/resource_quota.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace sgrpc
+{
+
+struct MemoryBudgetStats
+{
+   std::size_t limit{0}; //!< sgrpc's share of the budget
+   std::size_t used{0};  //!< Bytes currently reserved by sgrpc
+   std::size_t peak{0};  //!< High-water mark of `used`
+   uint64_t rejected{0}; //!< Reservations refused, e.g., calls rejected with `ResourceExhausted`
+};
+
+/**
+ * A cap on the memory of one server (or a group of servers), split in two shares, since grpc
+ * offers no way to charge its quota from outside:
+ *
+ * + grpc's own buffers are capped by `resource_quota()`, a `grpc::ResourceQuota` of
+ *   `grpc_share` of `max_bytes`, which `ServerOptions::memory_budget` applies to the server
+ *   builder.
+ * + sgrpc's own per-rpc allocations (handlers, requests, responses, cached responses) are
+ *   accounted here, against the rest (`limit()`): pass the budget to each method's
+ *   `ServerMethodOptions::memory_budget`, and to `ResponseCacheOptions::memory_budget`. Once
+ *   this share is spent, new calls are rejected with `ResourceExhausted` until earlier calls
+ *   finish.
+ *
+ * Together, the two stay within `max_bytes`.
+ *
+ * THREAD SAFE
+ */
+class MemoryBudget final
+{
+ public:
+   explicit MemoryBudget(std::size_t max_bytes,
+                         std::string name  = "sgrpc",
+                         double grpc_share = 0.5)
+       : grpc_limit_{static_cast<std::size_t>(static_cast<double>(max_bytes)
+                                              * std::clamp(grpc_share, 0.0, 1.0))}
+       , limit_{max_bytes - grpc_limit_}
+       , quota_{name}
+   {
+      quota_.Resize(grpc_limit_);
+   }
+
+   MemoryBudget(const MemoryBudget&)            = delete;
+   MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+   //!< Reserves `bytes`, unless that would exceed the limit
+   bool try_reserve(std::size_t bytes) noexcept
+   {
+      auto current = used_.load(std::memory_order_relaxed);
+      do {
+         if(current + bytes > limit_) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+         }
+      } while(!used_.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed));
+      update_peak_(current + bytes);
+      return true;
+   }
+
+   //!< Reserves `bytes` even past the limit; for memory that is already committed
+   void reserve(std::size_t bytes) noexcept
+   {
+      update_peak_(used_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+   }
+
+   void release(std::size_t bytes) noexcept { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+   std::size_t limit() const noexcept { return limit_; } //!< sgrpc's share
+   std::size_t grpc_limit() const noexcept { return grpc_limit_; }
+   std::size_t used() const noexcept { return used_.load(std::memory_order_relaxed); }
+
+   //!< Caps grpc's own memory at `grpc_limit()`; shared by every server built with this budget
+   grpc::ResourceQuota& resource_quota() noexcept { return quota_; }
+
+   //!< Caps grpc's own threads, across every server built with this budget
+   void set_max_threads(int max_threads) { quota_.SetMaxThreads(max_threads); }
+
+   MemoryBudgetStats stats() const noexcept
+   {
+      return {limit_,
+              used_.load(std::memory_order_relaxed),
+              peak_.load(std::memory_order_relaxed),
+              rejected_.load(std::memory_order_relaxed)};
+   }
+
+ private:
+   void update_peak_(std::size_t used) noexcept
+   {
+      auto peak = peak_.load(std::memory_order_relaxed);
+      while(used > peak && !peak_.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+   }
+
+   const std::size_t grpc_limit_;
+   const std::size_t limit_;
+   grpc::ResourceQuota quota_;
+   std::atomic<std::size_t> used_{0};
+   std::atomic<std::size_t> peak_{0};
+   std::atomic<uint64_t> rejected_{0};
+};
+
+namespace detail
+{
+   /**
+    * The bytes one rpc holds against a `MemoryBudget`; released on `reset` or destruction.
+    */
+   class MemoryReservation final
+   {
+    public:
+      MemoryReservation() = default;
+      MemoryReservation(const MemoryReservation&) = delete;
+      ~MemoryReservation() { reset(); }
+      MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+      //!< Replaces any current reservation; `false` if the budget is spent
+      bool try_acquire(MemoryBudget& budget, std::size_t bytes) noexcept
+      {
+         reset();
+         if(!budget.try_reserve(bytes)) return false;
+         budget_ = &budget;
+         bytes_  = bytes;
+         return true;
+      }
+
+      //!< Adds memory that is already committed (e.g., a response) to the reservation
+      void grow(std::size_t bytes) noexcept
+      {
+         if(budget_ == nullptr) return;
+         budget_->reserve(bytes);
+         bytes_ += bytes;
+      }
+
+      void reset() noexcept
+      {
+         if(budget_ != nullptr) budget_->release(std::exchange(bytes_, 0));
+         budget_ = nullptr;
+      }
+
+    private:
+      MemoryBudget* budget_{nullptr};
+      std::size_t bytes_{0};
+   };
+} // namespace detail
+
+} // namespace sgrpc
@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include "detail/serialize.hpp"
+#include "detail/sharded_lru_cache.hpp"
+
+#include <grpcpp/support/byte_buffer.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace sgrpc
+{
+
+struct ResponseCacheOptions
+{
+   std::size_t number_shards{16};           //!< Lock stripes; ~number of threads is a good start
+   std::size_t max_bytes{64 * 1024 * 1024}; //!< Approximate cap on memory used by the cache
+   std::chrono::milliseconds ttl{std::chrono::seconds{30}};
+   std::shared_ptr<MemoryBudget> memory_budget{}; //!< Optional; entries are charged against it
+};
+
+using ResponseCacheStats = detail::LruCacheStats;
+
+/**
+ * Caches responses keyed by the (deterministically) serialized request.
+ *
+ * Only use for idempotent rpcs, where identical requests may be answered with the same
+ * response until `ttl` expires.
+ *
+ * THREAD SAFE
+ */
+template<typename RequestType, typename ResponseType> class ResponseCache final
+{
+ public:
+   explicit ResponseCache(ResponseCacheOptions options = {})
+       : cache_{options.number_shards, options.max_bytes, options.ttl, options.memory_budget}
+   {}
+
+   static std::string make_key(const RequestType& request)
+   {
+      return detail::serialize_deterministic(request);
+   }
+
+   std::optional<ResponseType> find(std::string_view key) { return cache_.find(key); }
+
+   void insert(std::string key, const ResponseType& response)
+   {
+      cache_.insert(std::move(key), response, response.ByteSizeLong());
+   }
+
+   void clear() { cache_.clear(); }
+
+   ResponseCacheStats stats() const { return cache_.stats(); }
+
+ private:
+   detail::ShardedLruCache<ResponseType> cache_;
+};
+
+/**
+ * Caches the serialized responses of server methods, keyed by the method's full name, and the
+ * (deterministically) serialized request. A response is serialized once, when inserted, and
+ * a hit is written to the wire as it is: without running the method's logic, or serializing
+ * (or copying) the response again.
+ *
+ * Only use for methods whose response is a pure function of the request. A cache may be
+ * shared between methods.
+ *
+ * THREAD SAFE
+ */
+class ServerResponseCache final
+{
+ public:
+   explicit ServerResponseCache(ResponseCacheOptions options = {})
+       : cache_{options.number_shards, options.max_bytes, options.ttl, options.memory_budget}
+   {}
+
+   //!< `method` is the full method name, e.g., "/helloworld.Greeter/SayHello"
+   template<typename RequestType>
+   static std::string make_key(std::string_view method, const RequestType& request)
+   {
+      std::string key{method};
+      key += '\0';
+      key += detail::serialize_deterministic(request);
+      return key;
+   }
+
+   //!< The serialized response previously inserted under `key`; shares its slices
+   std::optional<grpc::ByteBuffer> find(std::string_view key) { return cache_.find(key); }
+
+   void insert(std::string key, grpc::ByteBuffer response)
+   {
+      const auto bytes = response.Length();
+      cache_.insert(std::move(key), std::move(response), bytes);
+   }
+
+   void clear() { cache_.clear(); }
+
+   ResponseCacheStats stats() const { return cache_.stats(); }
+
+ private:
+   detail::ShardedLruCache<grpc::ByteBuffer> cache_;
+};
+
+} // namespace sgrpc
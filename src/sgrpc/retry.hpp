@@ -0,0 +1,392 @@
+
+#pragma once
+
+#include "detail/alarm.hpp"
+#include "detail/base_inc.hpp"
+#include "detail/utils.hpp"
+
+#include "execution_context.hpp"
+#include "rpc_status.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace sgrpc
+{
+
+/**
+ * Token-bucket that throttles retries when a backend is failing, to prevent retry storms.
+ *
+ * Follows grpc's retry-throttling scheme:
+ * + The bucket starts full, with `max_tokens`.
+ * + Every failed attempt withdraws 1 token; every success deposits `token_ratio` tokens.
+ * + Retries are only permitted while the bucket holds more than half of `max_tokens`.
+ *
+ * Share one budget (via `shared_ptr`) between all the calls to a backend.
+ *
+ * THREAD SAFE
+ */
+class RetryBudget final
+{
+ public:
+   explicit RetryBudget(double max_tokens = 10.0, double token_ratio = 0.1) noexcept
+       : max_milli_tokens_{to_milli_(max_tokens)}
+       , milli_token_ratio_{to_milli_(token_ratio)}
+       , milli_tokens_{max_milli_tokens_}
+   {}
+
+   void record_success() noexcept { add_(milli_token_ratio_); }
+   void record_failure() noexcept { add_(-1000); }
+   bool can_retry() const noexcept
+   {
+      return milli_tokens_.load(std::memory_order_relaxed) > max_milli_tokens_ / 2;
+   }
+   double tokens() const noexcept
+   {
+      return static_cast<double>(milli_tokens_.load(std::memory_order_relaxed)) / 1000.0;
+   }
+
+ private:
+   static int64_t to_milli_(double tokens) noexcept
+   {
+      return static_cast<int64_t>(tokens * 1000.0);
+   }
+
+   void add_(int64_t delta) noexcept
+   {
+      auto current = milli_tokens_.load(std::memory_order_relaxed);
+      while(!milli_tokens_.compare_exchange_weak(
+          current,
+          std::clamp<int64_t>(current + delta, 0, max_milli_tokens_),
+          std::memory_order_relaxed)) {}
+   }
+
+   const int64_t max_milli_tokens_;
+   const int64_t milli_token_ratio_;
+   std::atomic<int64_t> milli_tokens_;
+};
+
+/**
+ * Counters for observing the retry behaviour of one or more `retry(...)` senders.
+ *
+ * THREAD SAFE
+ */
+struct RetryMetrics
+{
+   std::atomic<uint64_t> calls{0};              //!< Number of retry senders started
+   std::atomic<uint64_t> attempts{0};           //!< Total attempts, including the first
+   std::atomic<uint64_t> retries{0};            //!< Attempts after the first
+   std::atomic<uint64_t> budget_exhausted{0};   //!< Retries denied by the `RetryBudget`
+   std::atomic<uint64_t> attempts_exhausted{0}; //!< Calls that failed after `max_attempts`
+};
+
+/**
+ * Describes when, and how often, a failed rpc is re-issued.
+ *
+ * The backoff before retry `n` (1-based) is:
+ * ~~~
+ * min(initial_backoff * backoff_multiplier^(n-1), max_backoff) * (1 +/- jitter)
+ * ~~~
+ */
+struct RetryPolicy
+{
+   unsigned max_attempts{3}; //!< Including the first attempt
+   std::chrono::milliseconds initial_backoff{50};
+   std::chrono::milliseconds max_backoff{5000};
+   double backoff_multiplier{2.0};
+   double jitter{0.2}; //!< In [0, 1]; the fraction of the backoff that is randomized
+   std::vector<RpcStatusCode> retryable_codes{RpcStatusCode::Unavailable};
+   std::shared_ptr<RetryBudget> budget{};   //!< Optional
+   std::shared_ptr<RetryMetrics> metrics{}; //!< Optional
+
+   bool is_retryable(RpcStatusCode code) const
+   {
+      return std::find(cbegin(retryable_codes), cend(retryable_codes), code)
+             != cend(retryable_codes);
+   }
+
+   std::chrono::nanoseconds backoff(unsigned retry_number) const
+   {
+      thread_local std::minstd_rand generator{std::random_device{}()};
+      double delay = static_cast<double>(initial_backoff.count());
+      for(auto i = 1u; i < retry_number && delay < max_backoff.count(); ++i)
+         delay *= backoff_multiplier;
+      delay = std::min(delay, static_cast<double>(max_backoff.count()));
+
+      const double spread = std::clamp(jitter, 0.0, 1.0);
+      std::uniform_real_distribution<double> distribution{1.0 - spread, 1.0 + spread};
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double, std::milli>{delay * distribution(generator)});
+   }
+};
+
+/**
+ * A sender that completes on an `ExecutionContext`, e.g., a `ClientRpcSender`; that context
+ * also times the backoffs of `retry(...)`.
+ */
+template<typename Sender>
+concept ContextSender = stdexec::sender<Sender> && requires(const Sender& sender) {
+   {
+      stdexec::get_completion_scheduler<stdexec::set_value_t>(sender)
+   } -> std::same_as<Scheduler>;
+};
+
+namespace detail
+{
+   //!< `Signatures`, plus `set_stopped_t()` if it is not there already
+   template<typename Signatures> struct WithStopped;
+   template<typename... Signatures>
+   struct WithStopped<stdexec::completion_signatures<Signatures...>>
+   {
+      using type = std::conditional_t<
+          (std::is_same_v<Signatures, stdexec::set_stopped_t()> || ...),
+          stdexec::completion_signatures<Signatures...>,
+          stdexec::completion_signatures<Signatures..., stdexec::set_stopped_t()>>;
+   };
+
+   /**
+    * Operation State for `retry(...)`: reconnects a copy of `sender_` for every attempt.
+    * Backoff is an alarm on the execution context's completion queues, so no thread blocks.
+    * A stop request cancels a pending backoff, and the operation completes with `set_stopped`.
+    */
+   template<typename Sender, typename Receiver> struct RetryOpState
+   {
+      struct InnerReceiver
+      {
+         RetryOpState* op_;
+
+         template<typename... Values>
+         friend void
+         tag_invoke(stdexec::set_value_t, InnerReceiver&& self, Values&&... values) noexcept
+         {
+            self.op_->on_success();
+            stdexec::set_value(std::move(self.op_->receiver_), std::forward<Values>(values)...);
+         }
+
+         template<typename Error>
+         friend void tag_invoke(stdexec::set_error_t, InnerReceiver&& self, Error&& error) noexcept
+         {
+            self.op_->on_error(std::forward<Error>(error));
+         }
+
+         friend void tag_invoke(stdexec::set_stopped_t, InnerReceiver&& self) noexcept
+         {
+            self.op_->stop_();
+         }
+
+         friend auto tag_invoke(stdexec::get_env_t, const InnerReceiver& self) noexcept
+         {
+            return stdexec::get_env(self.op_->receiver_);
+         }
+      };
+
+      using InnerOpState = stdexec::connect_result_t<Sender&, InnerReceiver>;
+      using StopToken    = stdexec::stop_token_of_t<stdexec::env_of_t<Receiver>>;
+
+      struct OnStopRequested
+      {
+         RetryOpState* op_;
+         void operator()() noexcept { op_->on_stop_requested(); }
+      };
+      using StopCallback = typename StopToken::template callback_type<OnStopRequested>;
+
+      Sender sender_;
+      RetryPolicy policy_;
+      [[no_unique_address]] Receiver receiver_;
+      std::optional<InnerOpState> inner_op_;
+      unsigned attempt_{0};
+
+      std::optional<StopCallback> on_stop_;
+      std::mutex padlock_;              //!< Guards `backoff_` and `is_stop_requested_`
+      detail::Alarm* backoff_{nullptr}; //!< The pending backoff, if any
+      bool is_stop_requested_{false};
+
+      RetryOpState(Sender&& sender, RetryPolicy&& policy, Receiver&& receiver)
+          : sender_{std::move(sender)}
+          , policy_{std::move(policy)}
+          , receiver_{std::move(receiver)}
+      {}
+      RetryOpState(RetryOpState&&)            = delete;
+      RetryOpState& operator=(RetryOpState&&) = delete;
+
+      friend void tag_invoke(stdexec::start_t, RetryOpState& self) noexcept
+      {
+         if(self.policy_.metrics)
+            self.policy_.metrics->calls.fetch_add(1, std::memory_order_relaxed);
+         if constexpr(!stdexec::unstoppable_token<StopToken>)
+            self.on_stop_.emplace(stdexec::get_stop_token(stdexec::get_env(self.receiver_)),
+                                  OnStopRequested{&self});
+         self.start_attempt();
+      }
+
+      void start_attempt() noexcept
+      {
+         ++attempt_;
+         if(policy_.metrics) policy_.metrics->attempts.fetch_add(1, std::memory_order_relaxed);
+         inner_op_.reset();
+         inner_op_.emplace(
+             EmplaceFrom{[this]() { return stdexec::connect(sender_, InnerReceiver{this}); }});
+         stdexec::start(*inner_op_);
+      }
+
+      void on_success() noexcept
+      {
+         if(policy_.budget) policy_.budget->record_success();
+         on_stop_.reset();
+      }
+
+      //!< Inner operations observe the same stop token; only a pending backoff is cancelled here
+      void on_stop_requested() noexcept
+      {
+         std::lock_guard lock{padlock_};
+         is_stop_requested_ = true;
+         if(backoff_ != nullptr) backoff_->cancel();
+      }
+
+      template<typename Error> void fail_(Error&& error) noexcept
+      {
+         on_stop_.reset();
+         stdexec::set_error(std::move(receiver_), std::forward<Error>(error));
+      }
+
+      void stop_() noexcept
+      {
+         on_stop_.reset();
+         stdexec::set_stopped(std::move(receiver_));
+      }
+
+      //!< Called by the backoff alarm; `is_ok` is false if cancelled or shutting down
+      template<typename Error> void on_backoff_(bool is_ok, Error&& last_error) noexcept
+      {
+         bool is_stop_requested = false;
+         {
+            std::lock_guard lock{padlock_};
+            backoff_          = nullptr;
+            is_stop_requested = is_stop_requested_;
+         }
+         if(is_stop_requested)
+            stop_();
+         else if(is_ok)
+            start_attempt();
+         else // The context is shutting down
+            fail_(std::forward<Error>(last_error));
+      }
+
+      template<typename Error> void on_error(Error&& error) noexcept
+      {
+         const auto code = status_code_of(error); // Not an rpc error => never retried
+         if(!code.has_value() || !policy_.is_retryable(*code)) {
+            fail_(std::forward<Error>(error));
+            return;
+         }
+
+         if(policy_.budget) policy_.budget->record_failure();
+
+         if(attempt_ >= std::max(policy_.max_attempts, 1u)) {
+            if(policy_.metrics)
+               policy_.metrics->attempts_exhausted.fetch_add(1, std::memory_order_relaxed);
+            fail_(std::forward<Error>(error));
+            return;
+         }
+
+         if(policy_.budget && !policy_.budget->can_retry()) {
+            if(policy_.metrics)
+               policy_.metrics->budget_exhausted.fetch_add(1, std::memory_order_relaxed);
+            fail_(std::forward<Error>(error));
+            return;
+         }
+
+         if(policy_.metrics) policy_.metrics->retries.fetch_add(1, std::memory_order_relaxed);
+
+         // The next attempt is started from an alarm, which also guarantees that the
+         // current inner operation has finished completing before it is destroyed.
+         ExecutionContext& context
+             = stdexec::get_completion_scheduler<stdexec::set_value_t>(sender_).context();
+         auto last_error = std::decay_t<Error>{std::forward<Error>(error)};
+
+         std::unique_lock lock{padlock_};
+         if(is_stop_requested_) {
+            lock.unlock();
+            stop_();
+            return;
+         }
+         const bool did_post = context.post_to_cq([&](grpc::CompletionQueue& cq) {
+            backoff_ = new detail::Alarm{cq,
+                                         [this, last_error](bool is_ok) mutable {
+                                            on_backoff_(is_ok, std::move(last_error));
+                                         },
+                                         detail::duration_to_grp_timespec(
+                                             policy_.backoff(attempt_))};
+         });
+         lock.unlock();
+         if(!did_post) fail_(std::move(last_error));
+      }
+   };
+} // namespace detail
+
+/**
+ * A sender adaptor that re-issues `Sender` whenever it fails with a retryable status code.
+ *
+ * `Sender` is copied for each attempt; `ClientRpcSender` and `PureClientRpcSender` can be
+ * re-issued this way because the request is retained by their call factories.
+ */
+template<ContextSender Sender> class RetrySender
+{
+ private:
+   /**
+    * OperationState connect(RetrySender self, Receiver receiver)
+    */
+   template<class R> friend auto tag_invoke(stdexec::connect_t, RetrySender self, R&& receiver)
+   {
+      return detail::RetryOpState<Sender, std::remove_cvref_t<R>>{
+          std::move(self.sender_), std::move(self.policy_), std::move(receiver)};
+   }
+
+   /**
+    * Scheduler get_completion_scheduler(RetrySender self)
+    */
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               RetrySender self) noexcept
+   {
+      return stdexec::get_completion_scheduler<stdexec::set_value_t>(self.sender_);
+   }
+
+ public:
+   //!< Those of `Sender`, and `set_stopped`, on a stop request during a backoff
+   using completion_signatures =
+       typename detail::WithStopped<typename Sender::completion_signatures>::type;
+
+   RetrySender(Sender sender, RetryPolicy policy)
+       : sender_{std::move(sender)}
+       , policy_{std::move(policy)}
+   {}
+
+ private:
+   Sender sender_;
+   RetryPolicy policy_;
+};
+
+/**
+ * ~~~
+ * auto budget = std::make_shared<sgrpc::RetryBudget>();
+ * stdexec::sender auto snd = sgrpc::retry(client.say_hello("Tritarch"),
+ *                                         sgrpc::RetryPolicy{.max_attempts = 5, .budget = budget});
+ * ~~~
+ */
+template<typename Sender>
+   requires ContextSender<std::remove_cvref_t<Sender>>
+RetrySender<std::remove_cvref_t<Sender>> retry(Sender&& sender, RetryPolicy policy = {})
+{
+   return {std::forward<Sender>(sender), std::move(policy)};
+}
+
+} // namespace sgrpc
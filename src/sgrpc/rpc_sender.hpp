@@ -4,6 +4,7 @@
 #include "stdinc.hpp"
 
 #include "detail/base_inc.hpp"
+#include "detail/inline_rpc_operation_state.hpp"
 #include "detail/rpc_sender_operation_states.hpp"
 
 #include "execution_context.hpp"
@@ -30,6 +31,7 @@ template<typename Service, typename RequestType, typename ResponseType> class Pu
               self.context_,
               std::move(self.factory_fn_),
               std::move(self.request_),
+              std::move(self.options_),
               std::move(receiver)};
    }
 
@@ -48,16 +50,19 @@ template<typename Service, typename RequestType, typename ResponseType> class Pu
 
    PureClientRpcSender(ExecutionContext& context,
                        ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn,
-                       RequestType request)
+                       RequestType request,
+                       ClientCallOptions options = {})
        : context_{context}
        , factory_fn_{std::move(factory_fn)}
        , request_{std::move(request)}
+       , options_{std::move(options)}
    {}
 
  private:
    ExecutionContext& context_;
    ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn_;
-   std::shared_ptr<RequestType> request_;
+   RequestType request_;
+   ClientCallOptions options_;
 };
 
 /**
@@ -103,4 +108,64 @@ template<typename ResultType> class ClientRpcSender
    WrappedRpcFactory<ResultType> call_factory_;
 };
 
+/**
+ * A statically typed RpcSender: completes with the converted ResultType, like
+ * `ClientRpcSender`, but the entire call path (rpc state, conversion, receiver) lives in
+ * one operation state. Use `ClientRpcSender` where the grpc types must stay hidden, e.g.,
+ * behind a pimpl.
+ */
+template<typename Service,
+         typename RequestType,
+         typename ResponseType,
+         typename ResultType,
+         typename ConversionFunction>
+class InlineClientRpcSender
+{
+ private:
+   template<class R>
+   friend auto tag_invoke(stdexec::connect_t, InlineClientRpcSender self, R&& receiver)
+   {
+      return detail::InlineRpcOpState<Service,
+                                      RequestType,
+                                      ResponseType,
+                                      ResultType,
+                                      ConversionFunction,
+                                      std::remove_cvref_t<R>>{self.context_,
+                                                              std::move(self.factory_fn_),
+                                                              std::move(self.request_),
+                                                              std::move(self.options_),
+                                                              std::move(self.convert_),
+                                                              std::move(receiver)};
+   }
+
+   friend Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                               InlineClientRpcSender self) noexcept
+   {
+      return Scheduler{self.context_};
+   }
+
+ public:
+   using completion_signatures = stdexec::completion_signatures<stdexec::set_value_t(ResultType),
+                                                                stdexec::set_error_t(RpcStatus)>;
+
+   InlineClientRpcSender(ExecutionContext& context,
+                         ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn,
+                         RequestType request,
+                         ClientCallOptions options = {},
+                         ConversionFunction convert = {})
+       : context_{context}
+       , factory_fn_{std::move(factory_fn)}
+       , request_{std::move(request)}
+       , options_{std::move(options)}
+       , convert_{std::move(convert)}
+   {}
+
+ private:
+   ExecutionContext& context_;
+   ResponseReaderFactory<Service, RequestType, ResponseType> factory_fn_;
+   RequestType request_;
+   ClientCallOptions options_;
+   [[no_unique_address]] ConversionFunction convert_;
+};
+
 } // namespace sgrpc
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include "admission_controller.hpp"
+#include "call_options.hpp"
+#include "execution_context.hpp"
+#include "memory_budget.hpp"
+#include "response_cache.hpp"
+#include "server_metrics.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace sgrpc
+{
+
+/**
+ * Where a server method's logic runs
+ */
+enum class ExecutionPolicy : int {
+   Default, //!< Plain logic runs inline; sender logic is scheduled on the handler's scheduler
+   Inline,  //!< On the thread polling the completion queue; for trivial logic only
+   Offload  //!< Scheduled on `offload_to`, if set, or else on the handler's scheduler
+};
+
+/**
+ * Options for one method of a server, e.g., one `ServerRpcHandler`.
+ */
+struct ServerMethodOptions
+{
+   std::optional<CompressionOptions> compression; //!< Of responses
+   ExecutionPolicy execution{ExecutionPolicy::Default};
+   ExecutionContext* offload_to{nullptr}; //!< Optional; e.g., a separate context for heavy logic
+   std::size_t request_slots{1};      //!< Requests awaited concurrently, per completion queue
+   std::size_t max_idle_handlers{64}; //!< Finished handlers kept for reuse, per completion queue
+   std::shared_ptr<AdmissionController> admission{}; //!< Optional; sheds load when queueing
+   std::shared_ptr<ServerResponseCache> cache{};     //!< Optional; for pure methods only
+   std::shared_ptr<MemoryBudget> memory_budget{};    //!< Optional; rejects calls once spent
+   std::shared_ptr<MethodMetrics> metrics{};         //!< Optional; e.g., `ServerMetrics::method`
+};
+
+namespace detail
+{
+   //!< Configures `server_context` for sending a response of `response_bytes`
+   inline void apply_method_options(grpc::ServerContextBase& server_context,
+                                    const ServerMethodOptions& options,
+                                    std::size_t response_bytes)
+   {
+      if(!options.compression.has_value()
+         || response_bytes < options.compression->min_message_bytes)
+         return;
+      if(options.compression->level != CompressionLevel::None)
+         server_context.set_compression_level(
+             to_grpc_compression_level(options.compression->level));
+      else
+         server_context.set_compression_algorithm(
+             to_grpc_compression_algorithm(options.compression->algorithm));
+   }
+} // namespace detail
+
+} // namespace sgrpc
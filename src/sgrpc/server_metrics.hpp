@@ -0,0 +1,397 @@
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sgrpc
+{
+
+inline constexpr std::size_t k_number_status_codes    = 17; //!< `grpc::StatusCode` 0..16
+inline constexpr std::size_t k_number_latency_buckets = 25; //!< 1us, 2us, 4us, ... 8.4s, +Inf
+
+/**
+ * A latency histogram with power-of-two buckets, from 1us
+ */
+struct LatencyHistogramSnapshot
+{
+   std::array<uint64_t, k_number_latency_buckets> counts{}; //!< Not cumulative
+   uint64_t count{0};
+   std::chrono::nanoseconds sum{0};
+
+   //!< Inclusive upper bound of bucket `index`; the last bucket is unbounded
+   static constexpr std::chrono::nanoseconds upper_bound(std::size_t index) noexcept
+   {
+      return index + 1 >= k_number_latency_buckets ? std::chrono::nanoseconds::max()
+                                                   : std::chrono::nanoseconds{1000ll << index};
+   }
+
+   //!< The upper bound of the bucket containing quantile `q` (in [0, 1]); an overestimate
+   std::chrono::nanoseconds quantile(double q) const noexcept
+   {
+      const auto rank = static_cast<uint64_t>(q * static_cast<double>(count));
+      uint64_t seen   = 0;
+      for(std::size_t i = 0; i < counts.size(); ++i) {
+         seen += counts[i];
+         if(seen > rank || (seen == count && seen > 0)) return upper_bound(i);
+      }
+      return std::chrono::nanoseconds{0};
+   }
+
+   std::chrono::nanoseconds mean() const noexcept
+   {
+      return count == 0 ? std::chrono::nanoseconds{0} : sum / static_cast<int64_t>(count);
+   }
+};
+
+struct MethodMetricsSnapshot
+{
+   std::string method;
+   uint64_t requests{0};
+   std::array<uint64_t, k_number_status_codes> status_counts{}; //!< Indexed by status code
+   int64_t in_flight{0};
+   LatencyHistogramSnapshot queue_time; //!< Arrival to logic start
+   LatencyHistogramSnapshot logic_time; //!< Logic start to response
+   LatencyHistogramSnapshot total_time; //!< Arrival to response, including rejected calls
+};
+
+namespace detail
+{
+   //!< A small, stable index per thread, so that threads mostly write to separate stripes
+   inline std::size_t metrics_stripe_index() noexcept
+   {
+      static std::atomic<std::size_t> next_index{0};
+      thread_local const std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+      return index;
+   }
+
+   inline std::string_view status_code_name(std::size_t code) noexcept
+   {
+      static constexpr std::string_view k_names[k_number_status_codes]
+          = {"OK",
+             "CANCELLED",
+             "UNKNOWN",
+             "INVALID_ARGUMENT",
+             "DEADLINE_EXCEEDED",
+             "NOT_FOUND",
+             "ALREADY_EXISTS",
+             "PERMISSION_DENIED",
+             "RESOURCE_EXHAUSTED",
+             "FAILED_PRECONDITION",
+             "ABORTED",
+             "OUT_OF_RANGE",
+             "UNIMPLEMENTED",
+             "INTERNAL",
+             "UNAVAILABLE",
+             "DATA_LOSS",
+             "UNAUTHENTICATED"};
+      return code < k_number_status_codes ? k_names[code] : "UNKNOWN";
+   }
+} // namespace detail
+
+/**
+ * The metrics of one server method: request counts, responses by status code, calls in
+ * flight, and latency histograms of queue, logic, and total time.
+ *
+ * Recording is a handful of relaxed atomic adds on a cache-line aligned stripe chosen by
+ * thread, so threads (almost) never contend; a `snapshot` sums the stripes.
+ *
+ * Share one instance (via `ServerMethodOptions::metrics`) between the handlers of a method
+ * on every completion queue; `ServerMetrics` hands them out by method name.
+ *
+ * THREAD SAFE
+ */
+class MethodMetrics final
+{
+ public:
+   explicit MethodMetrics(std::string method)
+       : method_{std::move(method)}
+   {}
+
+   MethodMetrics(const MethodMetrics&)            = delete;
+   MethodMetrics& operator=(const MethodMetrics&) = delete;
+
+   const std::string& method() const noexcept { return method_; }
+
+   void record_arrival() noexcept
+   {
+      auto& stripe = stripe_();
+      stripe.requests.fetch_add(1, std::memory_order_relaxed);
+      stripe.in_flight.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   //!< `logic_started` is default (i.e., the epoch) if no logic ran, e.g., when rejected
+   void record_finish(grpc::StatusCode code,
+                      std::chrono::steady_clock::time_point arrived,
+                      std::chrono::steady_clock::time_point logic_started,
+                      std::chrono::steady_clock::time_point finished) noexcept
+   {
+      auto& stripe      = stripe_();
+      const auto status = std::min<std::size_t>(static_cast<std::size_t>(code),
+                                                k_number_status_codes - 1);
+      stripe.status_counts[status].fetch_add(1, std::memory_order_relaxed);
+      stripe.in_flight.fetch_sub(1, std::memory_order_relaxed);
+      stripe.total_time.record(finished - arrived);
+      if(logic_started != std::chrono::steady_clock::time_point{}) {
+         stripe.queue_time.record(logic_started - arrived);
+         stripe.logic_time.record(finished - logic_started);
+      }
+   }
+
+   MethodMetricsSnapshot snapshot() const
+   {
+      MethodMetricsSnapshot result;
+      result.method = method_;
+      for(const auto& stripe : stripes_) {
+         result.requests += stripe.requests.load(std::memory_order_relaxed);
+         for(std::size_t i = 0; i < k_number_status_codes; ++i)
+            result.status_counts[i] += stripe.status_counts[i].load(std::memory_order_relaxed);
+         result.in_flight += stripe.in_flight.load(std::memory_order_relaxed);
+         stripe.queue_time.add_to(result.queue_time);
+         stripe.logic_time.add_to(result.logic_time);
+         stripe.total_time.add_to(result.total_time);
+      }
+      return result;
+   }
+
+ private:
+   static constexpr std::size_t k_number_stripes = 16;
+
+   struct Histogram
+   {
+      std::array<std::atomic<uint64_t>, k_number_latency_buckets> counts{};
+      std::atomic<int64_t> sum_ns{0};
+
+      void record(std::chrono::nanoseconds latency) noexcept
+      {
+         const auto ns     = std::max<int64_t>(latency.count(), 0);
+         const auto micros = static_cast<uint64_t>(ns > 0 ? (ns - 1) / 1000 : 0);
+         const auto index  = std::min<std::size_t>(
+             static_cast<std::size_t>(std::bit_width(micros)), k_number_latency_buckets - 1);
+         counts[index].fetch_add(1, std::memory_order_relaxed);
+         sum_ns.fetch_add(ns, std::memory_order_relaxed);
+      }
+
+      void add_to(LatencyHistogramSnapshot& snapshot) const noexcept
+      {
+         for(std::size_t i = 0; i < k_number_latency_buckets; ++i) {
+            const auto count = counts[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += count;
+            snapshot.count += count;
+         }
+         snapshot.sum += std::chrono::nanoseconds{sum_ns.load(std::memory_order_relaxed)};
+      }
+   };
+
+   struct alignas(64) Stripe
+   {
+      std::atomic<uint64_t> requests{0};
+      std::array<std::atomic<uint64_t>, k_number_status_codes> status_counts{};
+      std::atomic<int64_t> in_flight{0}; //!< May be negative; only the sum is meaningful
+      Histogram queue_time;
+      Histogram logic_time;
+      Histogram total_time;
+   };
+
+   Stripe& stripe_() noexcept
+   {
+      return stripes_[detail::metrics_stripe_index() % k_number_stripes];
+   }
+
+   const std::string method_;
+   std::array<Stripe, k_number_stripes> stripes_;
+};
+
+/**
+ * The `MethodMetrics` of every method of a server, by method name (e.g.,
+ * "/helloworld.Greeter/SayHello"), with a Prometheus text dump.
+ *
+ * ~~~
+ * auto metrics = std::make_shared<sgrpc::ServerMetrics>();
+ * new ServerRpcHandler<Request, Reply>(
+ *     scheduler, bind_rpc(...), bind_logic(...), cq,
+ *     {.metrics = metrics->method("/helloworld.Greeter/SayHello")});
+ * ~~~
+ *
+ * THREAD SAFE
+ */
+class ServerMetrics final
+{
+ public:
+   //!< The metrics of `method`, created on first use
+   std::shared_ptr<MethodMetrics> method(std::string_view method)
+   {
+      std::lock_guard lock{padlock_};
+      auto ii = methods_.find(method);
+      if(ii == cend(methods_))
+         ii = methods_.emplace(method, std::make_shared<MethodMetrics>(std::string{method})).first;
+      return ii->second;
+   }
+
+   std::vector<MethodMetricsSnapshot> snapshot() const
+   {
+      std::vector<std::shared_ptr<MethodMetrics>> methods;
+      {
+         std::lock_guard lock{padlock_};
+         methods.reserve(methods_.size());
+         for(const auto& [name, metrics] : methods_) methods.push_back(metrics);
+      }
+      std::vector<MethodMetricsSnapshot> result;
+      result.reserve(methods.size());
+      for(const auto& metrics : methods) result.push_back(metrics->snapshot());
+      return result;
+   }
+
+   //!< The Prometheus text exposition format, with every metric name prefixed by `prefix`
+   std::string prometheus_text(std::string_view prefix = "sgrpc_server") const
+   {
+      const auto methods = snapshot();
+      std::string out;
+      auto it = std::back_inserter(out);
+
+      fmt::format_to(it, "# HELP {0}_requests_total Requests received.\n", prefix);
+      fmt::format_to(it, "# TYPE {0}_requests_total counter\n", prefix);
+      for(const auto& m : methods)
+         fmt::format_to(
+             it, "{}_requests_total{{method=\"{}\"}} {}\n", prefix, m.method, m.requests);
+
+      fmt::format_to(it, "# HELP {0}_responses_total Responses, by status code.\n", prefix);
+      fmt::format_to(it, "# TYPE {0}_responses_total counter\n", prefix);
+      for(const auto& m : methods)
+         for(std::size_t code = 0; code < k_number_status_codes; ++code)
+            if(m.status_counts[code] > 0)
+               fmt::format_to(it,
+                              "{}_responses_total{{method=\"{}\",code=\"{}\"}} {}\n",
+                              prefix,
+                              m.method,
+                              detail::status_code_name(code),
+                              m.status_counts[code]);
+
+      fmt::format_to(it, "# HELP {0}_in_flight Calls received and not yet answered.\n", prefix);
+      fmt::format_to(it, "# TYPE {0}_in_flight gauge\n", prefix);
+      for(const auto& m : methods)
+         fmt::format_to(it, "{}_in_flight{{method=\"{}\"}} {}\n", prefix, m.method, m.in_flight);
+
+      write_histogram_(it, prefix, "queue", "Arrival to logic start", methods, [](auto& m) {
+         return &m.queue_time;
+      });
+      write_histogram_(it, prefix, "logic", "Logic start to response", methods, [](auto& m) {
+         return &m.logic_time;
+      });
+      write_histogram_(it, prefix, "total", "Arrival to response", methods, [](auto& m) {
+         return &m.total_time;
+      });
+      return out;
+   }
+
+ private:
+   template<typename OutputIt, typename Select>
+   static void write_histogram_(OutputIt it,
+                                std::string_view prefix,
+                                std::string_view name,
+                                std::string_view help,
+                                const std::vector<MethodMetricsSnapshot>& methods,
+                                Select select)
+   {
+      fmt::format_to(it, "# HELP {}_{}_seconds {}.\n", prefix, name, help);
+      fmt::format_to(it, "# TYPE {}_{}_seconds histogram\n", prefix, name);
+      for(const auto& m : methods) {
+         const LatencyHistogramSnapshot& histogram = *select(m);
+         uint64_t cumulative                       = 0;
+         for(std::size_t i = 0; i < k_number_latency_buckets; ++i) {
+            cumulative += histogram.counts[i];
+            const auto bound = LatencyHistogramSnapshot::upper_bound(i);
+            if(bound == std::chrono::nanoseconds::max())
+               fmt::format_to(it,
+                              "{}_{}_seconds_bucket{{method=\"{}\",le=\"+Inf\"}} {}\n",
+                              prefix,
+                              name,
+                              m.method,
+                              cumulative);
+            else
+               fmt::format_to(it,
+                              "{}_{}_seconds_bucket{{method=\"{}\",le=\"{:g}\"}} {}\n",
+                              prefix,
+                              name,
+                              m.method,
+                              std::chrono::duration<double>{bound}.count(),
+                              cumulative);
+         }
+         fmt::format_to(it,
+                        "{}_{}_seconds_sum{{method=\"{}\"}} {:g}\n",
+                        prefix,
+                        name,
+                        m.method,
+                        std::chrono::duration<double>{histogram.sum}.count());
+         fmt::format_to(it,
+                        "{}_{}_seconds_count{{method=\"{}\"}} {}\n",
+                        prefix,
+                        name,
+                        m.method,
+                        histogram.count);
+      }
+   }
+
+   mutable std::mutex padlock_;
+   std::map<std::string, std::shared_ptr<MethodMetrics>, std::less<>> methods_;
+};
+
+namespace detail
+{
+   /**
+    * Times one call of a method, for its `MethodMetrics`; does nothing without metrics.
+    * A call that is never finished (e.g., at shutdown) is counted as `Cancelled`.
+    */
+   class CallRecorder final
+   {
+    public:
+      CallRecorder() = default;
+      CallRecorder(const CallRecorder&) = delete;
+      ~CallRecorder() { finish(grpc::StatusCode::CANCELLED); }
+      CallRecorder& operator=(const CallRecorder&) = delete;
+
+      void arrive(MethodMetrics* metrics) noexcept
+      {
+         finish(grpc::StatusCode::CANCELLED); // Any previous call
+         metrics_ = metrics;
+         if(metrics_ == nullptr) return;
+         arrived_       = std::chrono::steady_clock::now();
+         logic_started_ = {};
+         metrics_->record_arrival();
+      }
+
+      void start_logic() noexcept
+      {
+         if(metrics_ != nullptr) logic_started_ = std::chrono::steady_clock::now();
+      }
+
+      void finish(grpc::StatusCode code) noexcept
+      {
+         if(metrics_ == nullptr) return;
+         metrics_->record_finish(code, arrived_, logic_started_, std::chrono::steady_clock::now());
+         metrics_ = nullptr;
+      }
+
+    private:
+      MethodMetrics* metrics_{nullptr};
+      std::chrono::steady_clock::time_point arrived_;
+      std::chrono::steady_clock::time_point logic_started_;
+   };
+} // namespace detail
+
+} // namespace sgrpc
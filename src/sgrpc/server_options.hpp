@@ -0,0 +1,145 @@
+
+#pragma once
+
+#include "call_options.hpp"
+#include "memory_budget.hpp"
+#include "socket_address.hpp"
+
+#include <fmt/format.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sgrpc
+{
+
+/**
+ * Options for building a server container
+ */
+struct ServerOptions
+{
+   uint32_t number_work_queues{1}; //!< Server completion queues (per shard)
+   uint16_t port{0};               //!< If zero, then a port is selected
+
+   /**
+    * Listen here instead of on `0.0.0.0:port`; e.g., "unix:/run/greeting.sock" or
+    * "unix-abstract:greeting" for same-host clients. A "unix:" socket file is removed if
+    * stale, and removed again when the container is destroyed.
+    */
+   std::string address;
+
+   std::shared_ptr<grpc::ServerCredentials> credentials{grpc::InsecureServerCredentials()};
+   RpcBackend backend{RpcBackend::CompletionQueue}; //!< For containers that support both
+
+   /**
+    * `GenericServerContainer` only: the number of grpc servers to start on the same port
+    * (with SO_REUSEPORT), each with its own work queues. The kernel spreads connections
+    * across them, and each context thread polls "its" shard's queues first.
+    */
+   uint32_t number_shards{1};
+
+   //!< For methods without their own `ServerMethodOptions`; `min_message_bytes` is ignored
+   std::optional<CompressionOptions> default_compression;
+
+   //@{ Resource limits; unset means grpc's defaults
+   std::shared_ptr<MemoryBudget> memory_budget; //!< Caps grpc's memory at its `grpc_limit()`
+   std::optional<int> max_threads; //!< Of grpc, per server; see `MemoryBudget::set_max_threads`
+   std::optional<int> max_receive_message_bytes; //!< Larger requests fail `ResourceExhausted`
+   std::optional<int> max_send_message_bytes;
+   //@}
+
+   /**
+    * `GenericServerContainer` only: more services to serve alongside the server's own, on
+    * every shard, e.g., a `StatsService`. They must be callback (or sync) services, since
+    * only the server's own service is wired to the work queues.
+    */
+   std::vector<std::shared_ptr<grpc::Service>> services;
+};
+
+namespace detail
+{
+   inline bool is_tcp(const ServerOptions& options) noexcept
+   {
+      return address_kind(options.address) == AddressKind::Tcp;
+   }
+
+   inline std::string listening_address(const ServerOptions& options)
+   {
+      return options.address.empty() ? fmt::format("0.0.0.0:{}", options.port) : options.address;
+   }
+
+   //!< A tcp `address` without its port, if it has one; e.g., "[::1]" for "[::1]:50051"
+   inline std::string_view tcp_host(std::string_view address) noexcept
+   {
+      const auto colon = address.rfind(':');
+      if(colon != std::string_view::npos && !address.ends_with(']')
+         && address.find_first_not_of("0123456789", colon + 1) == std::string_view::npos)
+         return address.substr(0, colon);
+      return address;
+   }
+
+   //!< A tcp `address` with `port` in place of the port it asked for (e.g., zero)
+   inline std::string with_port(std::string_view address, uint16_t port)
+   {
+      return fmt::format("{}:{}", tcp_host(address), port);
+   }
+
+   /**
+    * Where a same-host client connects to the server, once `port` is known. A tcp address
+    * gets `port` in place of the port it asked for (e.g., zero), and a wildcard host (e.g.,
+    * "0.0.0.0:0") becomes "localhost".
+    */
+   inline std::string local_address(const ServerOptions& options, uint16_t port)
+   {
+      if(options.address.empty()) return fmt::format("localhost:{}", port);
+      if(!is_tcp(options)) return options.address;
+
+      const auto host = tcp_host(options.address);
+      for(const std::string_view wildcard : {"", "0.0.0.0", "[::]", "ipv4:0.0.0.0", "ipv6:[::]"})
+         if(host == wildcard) return fmt::format("localhost:{}", port);
+      return with_port(options.address, port);
+   }
+
+   //!< Listens on `listening_address(options)`; the port actually bound is written to
+   //!< `selected_port` when the server is built (and is meaningless for unix sockets)
+   inline void apply_server_options(grpc::ServerBuilder& builder,
+                                    const ServerOptions& options,
+                                    int* selected_port)
+   {
+      *selected_port = static_cast<int>(options.port);
+      builder.AddListeningPort(listening_address(options), options.credentials, selected_port);
+
+      // Resource limits; a memory budget's quota is shared by every server built with it, so
+      // its threads are capped by `MemoryBudget::set_max_threads`, rather than per server
+      if(options.memory_budget) {
+         if(options.max_threads.has_value())
+            throw std::invalid_argument{"with a memory budget, set max threads on the budget"};
+         builder.SetResourceQuota(options.memory_budget->resource_quota());
+      } else if(options.max_threads.has_value()) {
+         grpc::ResourceQuota quota;
+         quota.SetMaxThreads(*options.max_threads);
+         builder.SetResourceQuota(quota);
+      }
+      if(options.max_receive_message_bytes.has_value())
+         builder.SetMaxReceiveMessageSize(*options.max_receive_message_bytes);
+      if(options.max_send_message_bytes.has_value())
+         builder.SetMaxSendMessageSize(*options.max_send_message_bytes);
+
+      // Compression for methods that don't set their own
+      if(options.default_compression.has_value()) {
+         const auto& compression = *options.default_compression;
+         builder.SetDefaultCompressionAlgorithm(
+             to_grpc_compression_algorithm(compression.algorithm));
+         if(compression.level != CompressionLevel::None)
+            builder.SetDefaultCompressionLevel(to_grpc_compression_level(compression.level));
+      }
+   }
+} // namespace detail
+
+} // namespace sgrpc
@@ -3,12 +3,22 @@
 
 #include "detail/base_inc.hpp"
 
+#include "sgrpc/server_method_options.hpp"
 #include "sgrpc/rpc_sender.hpp"
 #include "sgrpc/scheduler.hpp"
 
 #include "detail/completion_queue_event.hpp"
+#include "detail/unary_call.hpp"
 
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace sgrpc
 {
@@ -31,6 +41,12 @@ using BindRpcRequestFunction = std::function<void(grpc::ServerContext*,
                                                   grpc::ServerCompletionQueue*,
                                                   void*)>;
 
+/**
+ * @brief `BindRpcRequestFunction` of a raw method, e.g., of grpc's `WithRawMethod_SayHello`,
+ * which reads requests and writes responses as serialized bytes.
+ */
+using RawBindRpcRequestFunction = BindRpcRequestFunction<grpc::ByteBuffer, grpc::ByteBuffer>;
+
 /**
  * @brief Factory method to create `BindRpcRequestFunction` thunks.
  *
@@ -54,7 +70,7 @@ auto bind_rpc(auto& service, auto bind_thunk)
  * @brief Logic to execute to service a server-side RPC
  */
 template<typename RequestType, typename ResponseType>
-using RpcLogicThunk = std::function<ResponseType(const grpc::ServerContext& server_context,
+using RpcLogicThunk = std::function<ResponseType(const grpc::ServerContextBase& server_context,
                                                  const RequestType& request_envelope)>;
 
 auto bind_logic(auto& server, auto logic_thunk)
@@ -64,6 +80,45 @@ auto bind_logic(auto& server, auto logic_thunk)
    return std::bind(logic_thunk, std::ref(server), _1, _2);
 }
 
+namespace detail
+{
+   /**
+    * Finished handlers of one method on one completion queue, kept to be re-armed rather
+    * than reallocated.
+    *
+    * THREAD SAFE
+    */
+   template<typename Handler> class ServerRpcHandlerPool final
+   {
+    public:
+      explicit ServerRpcHandlerPool(std::size_t max_idle)
+          : max_idle_{max_idle}
+      {}
+
+      //!< An idle handler, or `nullptr` if there are none
+      std::unique_ptr<Handler> acquire()
+      {
+         std::lock_guard lock{padlock_};
+         if(idle_.empty()) return nullptr;
+         auto handler = std::move(idle_.back());
+         idle_.pop_back();
+         return handler;
+      }
+
+      //!< Keeps `handler` for reuse, unless the pool is full
+      void release(std::unique_ptr<Handler>& handler)
+      {
+         std::lock_guard lock{padlock_};
+         if(idle_.size() < max_idle_) idle_.push_back(std::move(handler));
+      }
+
+    private:
+      std::mutex padlock_;
+      std::vector<std::unique_ptr<Handler>> idle_;
+      const std::size_t max_idle_;
+   };
+} // namespace detail
+
 /**
  * @brief Context for handling servier-side RPC requests
  *
@@ -77,17 +132,38 @@ auto bind_logic(auto& server, auto logic_thunk)
  *                      },
  *                      server_completion_queue);
  * ~~~
+ *
+ * `options.request_slots` handlers await requests on the completion queue at any time: when
+ * a request arrives, an idle handler (or a new one) takes its slot. Once the response is
+ * written, the handler is reset and returned to a pool shared by its siblings, so that
+ * bursts of requests don't allocate a handler each.
+ *
+ * `bind_request` may request a raw method (see `RawBindRpcRequestFunction`), in which case
+ * the handler parses requests and serializes responses itself. Only raw methods, constructed
+ * with their full `method` name, may set `options.cache`: cached responses are written
+ * exactly as they were serialized.
  */
 template<typename RequestType,
          typename ResponseType,
          typename BindRequest = BindRpcRequestFunction<RequestType, ResponseType>,
          typename RpcLogic    = RpcLogicThunk<RequestType, ResponseType>>
-class ServerRpcHandler : public CompletionQueueEvent
+class ServerRpcHandler
+    : public CompletionQueueEvent
+    , private detail::
+          UnaryCall<ServerRpcHandler<RequestType, ResponseType, BindRequest, RpcLogic>,
+                    grpc::ServerContext,
+                    RequestType,
+                    ResponseType,
+                    RpcLogic>
 {
  private:
-   enum class Status : int { Start, Finish };
-   using LogicResultType =
-       typename std::result_of<RpcLogic && (const grpc::ServerContext&, const RequestType&)>::type;
+   using Pool = detail::ServerRpcHandlerPool<ServerRpcHandler>;
+   using Call = detail::UnaryCall<ServerRpcHandler,
+                                  grpc::ServerContext,
+                                  RequestType,
+                                  ResponseType,
+                                  RpcLogic>;
+   friend Call;
 
  public:
    // Scheduler: Where to put the async computation
@@ -95,82 +171,174 @@ class ServerRpcHandler : public CompletionQueueEvent
    // Server+MemFn: Logic to handle request, eg., std::string say_hello(std::string)
    // Conversion Functions: Convert RPC types to/from application types
    // CompletionQueue: Used by grpc to process events
+   // Options: Per-method settings, e.g., response compression
 
    ServerRpcHandler(Scheduler scheduler,
                     BindRequest bind_request,
                     RpcLogic logic,
-                    grpc::ServerCompletionQueue& cq)
-       : scheduler_{scheduler} // , service_{service}
-       , bind_request_{bind_request}
-       , logic_{logic}
-       , cq_{cq}
-       , response_writer_{&server_context_}
+                    grpc::ServerCompletionQueue& cq,
+                    ServerMethodOptions options = {}) noexcept(false)
+       : ServerRpcHandler{scheduler,
+                          std::string{},
+                          std::move(bind_request),
+                          std::move(logic),
+                          cq,
+                          std::move(options)}
+   {}
+
+   //!< `method` is the full method name, e.g., "/helloworld.Greeter/SayHello"
+   ServerRpcHandler(Scheduler scheduler,
+                    std::string method,
+                    BindRequest bind_request,
+                    RpcLogic logic,
+                    grpc::ServerCompletionQueue& cq,
+                    ServerMethodOptions options = {}) noexcept(false)
+       : ServerRpcHandler{std::make_shared<Pool>(options.max_idle_handlers),
+                          std::make_shared<const std::string>(std::move(method)),
+                          scheduler,
+                          bind_request,
+                          logic,
+                          cq,
+                          options}
    {
-      // Bind the request (this object) to completion queue `cq`.
-      // Note: `this` lifecycle now controlled by the completion queue
-      bind_request_(&server_context_, &request_, &response_writer_, &cq_, &cq_, this);
+      if(options_.cache && (!is_raw_ || method_->empty()))
+         throw std::invalid_argument{"only a raw method, with its name, may be cached"};
+
+      // The sibling slots first, because once armed, `this` may already be running
+      for(std::size_t i = 1; i < options_.request_slots; ++i)
+         (new ServerRpcHandler{pool_, method_, scheduler_, bind_request_, logic_, cq_, options_})
+             ->arm_();
+      arm_();
    }
 
    ~ServerRpcHandler() = default;
 
    void complete(bool is_okay) noexcept override
    {
-      if(delete_on_next_complete_ || !is_okay) {
+      if(is_finishing_) {
+         recycle_();
+
+      } else if(!is_okay) { // Shutting down
          delete this;
 
       } else {
-         // Spawn a new RpcCallContext to service incoming requests
-         new ServerRpcHandler{scheduler_, bind_request_, logic_, cq_};
-
-         // Will delete on next call to `proceed`
-         delete_on_next_complete_ = true;
-
-         // This is "immediate-mode" logic
-         constexpr bool is_executed_immediately = !stdexec::sender<LogicResultType>;
-         if constexpr(is_executed_immediately) {
-            try {
-               response_writer_.Finish(logic_(server_context_, request_), grpc::Status::OK, this);
-            } catch(...) {
-               // TODO: log here
-               response_writer_.Finish(
-                   ResponseType{}, grpc::Status{grpc::StatusCode::INTERNAL, ""}, this);
-            }
+         // Fill the slot this handler just vacated
+         spawn_();
 
-         } else {
-            // Schedule the sender for execution
-            stdexec::sender auto work
-                = stdexec::schedule(scheduler_)       // Execute on execution_context
-                  | logic_(server_context_, request_) // The specified logic
-                  | stdexec::then([this](const ResponseType& response) { // Write response
-                       response_writer_.Finish(response, grpc::Status::OK, this);
-                    })
-                  | stdexec::upon_error([this](auto... arg) { // Handle errors
-                       // auto status = grpc::Status{
-                       //     detail::to_grpc_status_code(status.error_code()),
-                       //     std::string{std::cbegin(status.details()),
-                       //     std::cend(status.details())}};
-                       auto grpc_status = grpc::Status{grpc::StatusCode::UNKNOWN, "TBA"};
-                       response_writer_.Finish(ResponseType{}, grpc_status, this);
-                    });
-
-            // Action!
-            stdexec::start_detached(work);
+         // Will recycle on next call to `complete`
+         is_finishing_ = true;
+         this->arrive_(options_);
+         if constexpr(is_raw_) {
+            const auto status = grpc::SerializationTraits<RequestType>::Deserialize(
+                &request_buffer_, &this->request_);
+            if(!status.ok()) {
+               this->fail_(status);
+               return;
+            }
          }
+         this->dispatch_(*server_context_, logic_, options_, scheduler_);
       }
    }
 
  private:
+   //!< Requests (and responds with) serialized messages?
+   static constexpr bool is_raw_
+       = std::is_invocable_v<BindRequest&,
+                             grpc::ServerContext*,
+                             grpc::ByteBuffer*,
+                             grpc::ServerAsyncResponseWriter<grpc::ByteBuffer>*,
+                             grpc::ServerCompletionQueue*,
+                             grpc::ServerCompletionQueue*,
+                             void*>;
+   using ResponseWriter = grpc::ServerAsyncResponseWriter<
+       std::conditional_t<is_raw_, grpc::ByteBuffer, ResponseType>>;
+
+   //!< Not yet armed
+   ServerRpcHandler(std::shared_ptr<Pool> pool,
+                    std::shared_ptr<const std::string> method,
+                    Scheduler scheduler,
+                    BindRequest bind_request,
+                    RpcLogic logic,
+                    grpc::ServerCompletionQueue& cq,
+                    ServerMethodOptions options)
+       : pool_{std::move(pool)}
+       , method_{std::move(method)}
+       , scheduler_{scheduler}
+       , bind_request_{std::move(bind_request)}
+       , logic_{std::move(logic)}
+       , cq_{cq}
+       , options_{std::move(options)}
+   {}
+
+   //!< Binds the request (this object) to the completion queue; `this` lifecycle is now
+   //!< controlled by the completion queue
+   void arm_()
+   {
+      is_finishing_ = false;
+      this->request_.Clear();
+      server_context_.emplace(); // grpc contexts are single use
+      response_writer_.emplace(&*server_context_);
+      if constexpr(is_raw_)
+         bind_request_(&*server_context_, &request_buffer_, &*response_writer_, &cq_, &cq_, this);
+      else
+         bind_request_(&*server_context_, &this->request_, &*response_writer_, &cq_, &cq_, this);
+   }
+
+   //!< Arms an idle handler from the pool, or a new one
+   void spawn_()
+   {
+      if(auto handler = pool_->acquire()) {
+         handler->pool_ = pool_;
+         handler.release()->arm_();
+      } else {
+         (new ServerRpcHandler{pool_, method_, scheduler_, bind_request_, logic_, cq_, options_})
+             ->arm_();
+      }
+   }
+
+   //!< Returns `this` to the pool, or deletes it if the pool is full
+   void recycle_() noexcept
+   {
+      this->reset_();
+      response_writer_.reset();
+      server_context_.reset();
+
+      // Idle handlers don't keep the pool alive; it goes with the last active handler
+      auto pool = std::move(pool_);
+      std::unique_ptr<ServerRpcHandler> self{this};
+      pool->release(self);
+   }
+
+   void write_response_(const ResponseType& response)
+   {
+      response_writer_->Finish(response, grpc::Status::OK, this);
+   }
+
+   void write_serialized_(grpc::ByteBuffer&& response)
+   {
+      response_writer_->Finish(response, grpc::Status::OK, this);
+   }
+
+   const std::string& method_name_() const noexcept { return *method_; }
+
+   void finish_with_error_(const grpc::Status& status)
+   {
+      response_writer_->FinishWithError(status, this);
+   }
+
+   std::shared_ptr<Pool> pool_;                 //!< Null while idle
+   std::shared_ptr<const std::string> method_; //!< Shared by the siblings; may be empty
+
    Scheduler scheduler_;
 
    BindRequest bind_request_;
    RpcLogic logic_;
 
    grpc::ServerCompletionQueue& cq_;
-   grpc::ServerContext server_context_;
-   grpc::ServerAsyncResponseWriter<ResponseType> response_writer_;
-
-   RequestType request_;
-
-   bool delete_on_next_complete_{false};
+   ServerMethodOptions options_;
+   std::optional<grpc::ServerContext> server_context_;
+   std::optional<ResponseWriter> response_writer_;
+   grpc::ByteBuffer request_buffer_; //!< Raw methods only
+   bool is_finishing_{false};
 };
 } // namespace sgrpc
@@ -1,11 +1,31 @@
 
 #pragma once
 
+#include "admission_controller.hpp"
+#include "call_options.hpp"
+#include "callback_rpc_stub.hpp"
+#include "callback_server_container.hpp"
+#include "channel_ready.hpp"
+#include "circuit_breaker.hpp"
 #include "client_rpc_stub.hpp"
+#include "client_stream.hpp"
+#include "client_stream_stub.hpp"
+#include "concurrency_limiter.hpp"
+#include "direct_rpc_stub.hpp"
+#include "endpoint_balancer.hpp"
 #include "execution_context.hpp"
+#include "generic_proxy_container.hpp"
 #include "generic_server_container.hpp"
+#include "memory_budget.hpp"
+#include "response_cache.hpp"
+#include "retry.hpp"
 #include "rpc_sender.hpp"
 #include "rpc_status.hpp"
 #include "rpc_status_code.hpp"
 #include "scheduler.hpp"
+#include "server_metrics.hpp"
+#include "server_method_options.hpp"
+#include "server_options.hpp"
 #include "server_rpc_handler.hpp"
+#include "single_flight.hpp"
+#include "socket_address.hpp"
@@ -0,0 +1,89 @@
+
+#pragma once
+
+#include "detail/inflight_rpc.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sgrpc
+{
+
+struct SingleFlightStats
+{
+   uint64_t flights{0};      //!< Rpcs actually issued
+   uint64_t deduplicated{0}; //!< Calls that shared another call's rpc
+};
+
+/**
+ * Deduplicates identical in-flight rpcs: the first caller for a key (the "leader") issues
+ * the rpc, and callers that arrive before it completes wait for the leader's response.
+ *
+ * The shared rpc is owned by the group (and the completion queue), and not by any waiter,
+ * so no single waiter can cancel it out from under the others.
+ *
+ * THREAD SAFE
+ */
+template<typename ResponseType> class SingleFlightGroup final
+{
+ public:
+   using Waiter = CompletionThunk<ResponseType>;
+
+   /**
+    * @return `true` if the caller is the leader, and must issue the rpc and then call `finish`.
+    */
+   bool join(const std::string& key, Waiter waiter)
+   {
+      std::lock_guard lock{padlock_};
+      auto [ii, is_leader] = flights_.try_emplace(key);
+      ii->second.push_back(std::move(waiter));
+      (is_leader ? flights_count_ : deduplicated_count_).fetch_add(1, std::memory_order_relaxed);
+      return is_leader;
+   }
+
+   /**
+    * Ends the flight for `key`, and delivers the response to every waiter. Every waiter but
+    * the last gets a copy; the last one gets `response` itself.
+    */
+   void finish(const std::string& key,
+               bool is_ok,
+               const grpc::Status& status,
+               ResponseType&& response) noexcept
+   {
+      std::vector<Waiter> waiters;
+      {
+         std::lock_guard lock{padlock_};
+         if(auto ii = flights_.find(key); ii != end(flights_)) {
+            waiters = std::move(ii->second);
+            flights_.erase(ii);
+         }
+      }
+      for(std::size_t i = 0; i < waiters.size(); ++i) {
+         try {
+            if(i + 1 == waiters.size())
+               waiters[i](is_ok, status, std::move(response));
+            else
+               waiters[i](is_ok, status, ResponseType{response});
+         } catch(...) {
+            // TODO: log here; one misbehaving waiter must not starve the rest
+         }
+      }
+   }
+
+   SingleFlightStats stats() const
+   {
+      return {flights_count_.load(std::memory_order_relaxed),
+              deduplicated_count_.load(std::memory_order_relaxed)};
+   }
+
+ private:
+   mutable std::mutex padlock_;
+   std::unordered_map<std::string, std::vector<Waiter>> flights_;
+   std::atomic<uint64_t> flights_count_{0};
+   std::atomic<uint64_t> deduplicated_count_{0};
+};
+
+} // namespace sgrpc
@@ -0,0 +1,144 @@
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace sgrpc
+{
+
+/**
+ * The kinds of address that grpc listens on, and connects to.
+ */
+enum class AddressKind : int {
+   Tcp,         //!< e.g., "localhost:50051", "dns:///host:50051", "ipv4:127.0.0.1:50051"
+   Unix,        //!< e.g., "unix:/run/greeting.sock", "unix:relative.sock"
+   UnixAbstract //!< Linux only, e.g., "unix-abstract:greeting"; no file, gone with the process
+};
+
+inline AddressKind address_kind(std::string_view address) noexcept
+{
+   if(address.starts_with("unix-abstract:")) return AddressKind::UnixAbstract;
+   if(address.starts_with("unix:")) return AddressKind::Unix;
+   return AddressKind::Tcp;
+}
+
+//!< "unix:<path>", for a socket file
+inline std::string unix_address(std::string_view path) { return "unix:" + std::string{path}; }
+
+//!< "unix-abstract:<name>", for a socket in Linux's abstract namespace
+inline std::string unix_abstract_address(std::string_view name)
+{
+   return "unix-abstract:" + std::string{name};
+}
+
+/**
+ * A channel to `address`, which may be any `AddressKind`. Unix sockets get "localhost" as
+ * their authority (rather than the socket path), so that virtual hosting, and any TLS
+ * certificate check, work the same as over loopback TCP.
+ */
+inline std::shared_ptr<grpc::Channel>
+make_channel(const std::string& address,
+             std::shared_ptr<grpc::ChannelCredentials> credentials
+             = grpc::InsecureChannelCredentials())
+{
+   if(address_kind(address) == AddressKind::Tcp)
+      return grpc::CreateChannel(address, std::move(credentials));
+   grpc::ChannelArguments arguments;
+   arguments.SetString(GRPC_ARG_DEFAULT_AUTHORITY, "localhost");
+   return grpc::CreateCustomChannel(address, std::move(credentials), arguments);
+}
+
+namespace detail
+{
+   /**
+    * Owns the socket file of a "unix:" listening address: a stale socket, left behind by a
+    * process that died without cleaning up, is removed before the server binds (or the bind
+    * would fail), and the socket is removed again on destruction. Does nothing for any
+    * other kind of address.
+    *
+    * Refuses to remove anything at the path that is not a socket, or a socket that some
+    * (live) server still accepts connections on.
+    */
+   class UnixSocketFile final
+   {
+    public:
+      UnixSocketFile() = default;
+      explicit UnixSocketFile(std::string_view address)
+      {
+         if(address_kind(address) != AddressKind::Unix) return;
+         path_ = address.substr(std::string_view{"unix:"}.size());
+         if(path_.starts_with("//")) path_.erase(0, 2); // "unix:///abs/path" (URI) form
+         remove_stale_();
+      }
+
+      UnixSocketFile(const UnixSocketFile&) = delete;
+      UnixSocketFile(UnixSocketFile&& other) noexcept
+          : path_{std::exchange(other.path_, {})}
+      {}
+      ~UnixSocketFile() { release_(); }
+
+      UnixSocketFile& operator=(const UnixSocketFile&) = delete;
+      UnixSocketFile& operator=(UnixSocketFile&& other) noexcept
+      {
+         if(this != &other) {
+            release_();
+            path_ = std::exchange(other.path_, {});
+         }
+         return *this;
+      }
+
+      const std::string& path() const noexcept { return path_; } //!< Empty if not a unix socket
+
+    private:
+      void remove_stale_() const
+      {
+         struct stat info;
+         if(::lstat(path_.c_str(), &info) != 0) return; // Nothing there
+         if(!S_ISSOCK(info.st_mode))
+            throw std::runtime_error{"refusing to replace non-socket file: " + path_};
+         if(is_listening_())
+            throw std::runtime_error{"address already in use: unix:" + path_};
+         if(::unlink(path_.c_str()) != 0 && errno != ENOENT)
+            throw std::runtime_error{"failed to remove stale socket " + path_ + ": "
+                                     + std::strerror(errno)};
+      }
+
+      bool is_listening_() const noexcept
+      {
+         sockaddr_un address{};
+         address.sun_family = AF_UNIX;
+         if(path_.size() >= sizeof(address.sun_path)) return false; // grpc will reject it
+         std::memcpy(address.sun_path, path_.c_str(), path_.size() + 1);
+
+         const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+         if(fd < 0) return false;
+         const bool is_connected
+             = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+         ::close(fd);
+         return is_connected;
+      }
+
+      void release_() noexcept
+      {
+         if(!path_.empty()) ::unlink(path_.c_str());
+         path_.clear();
+      }
+
+      std::string path_;
+   };
+} // namespace detail
+
+} // namespace sgrpc
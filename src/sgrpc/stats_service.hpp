@@ -0,0 +1,76 @@
+
+#pragma once
+
+#include "server_metrics.hpp"
+
+#include <protos/sgrpc_stats.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+
+namespace sgrpc
+{
+
+/**
+ * Serves a `ServerMetrics` as the `sgrpc.stats.Stats` grpc service (protos/sgrpc_stats.proto),
+ * e.g., for a dashboard, or a sidecar that re-exports the Prometheus text.
+ *
+ * A callback service, so it needs no completion queue of its own: add it to
+ * `ServerOptions::services` to serve it alongside the server's own methods.
+ *
+ * ~~~
+ * auto metrics = std::make_shared<sgrpc::ServerMetrics>();
+ * sgrpc::ServerOptions options{.services = {std::make_shared<sgrpc::StatsService>(metrics)}};
+ * ~~~
+ *
+ * Not included by "sgrpc.hpp", because it depends on generated code.
+ */
+class StatsService final : public stats::Stats::CallbackService
+{
+ public:
+   explicit StatsService(std::shared_ptr<const ServerMetrics> metrics)
+       : metrics_{std::move(metrics)}
+   {}
+
+   grpc::ServerUnaryReactor* GetStats(grpc::CallbackServerContext* context,
+                                      const stats::StatsRequest* request,
+                                      stats::StatsReply* reply) override
+   {
+      for(const auto& snapshot : metrics_->snapshot()) {
+         auto& method = *reply->add_methods();
+         method.set_method(snapshot.method);
+         method.set_requests(snapshot.requests);
+         for(std::size_t code = 0; code < k_number_status_codes; ++code)
+            if(snapshot.status_counts[code] > 0)
+               (*method.mutable_status_counts())[std::string{detail::status_code_name(code)}]
+                   = snapshot.status_counts[code];
+         method.set_in_flight(snapshot.in_flight);
+         copy_histogram_(snapshot.queue_time, *method.mutable_queue_time());
+         copy_histogram_(snapshot.logic_time, *method.mutable_logic_time());
+         copy_histogram_(snapshot.total_time, *method.mutable_total_time());
+      }
+      if(request->prometheus()) reply->set_prometheus_text(metrics_->prometheus_text());
+
+      auto* reactor = context->DefaultReactor();
+      reactor->Finish(grpc::Status::OK);
+      return reactor;
+   }
+
+ private:
+   static void copy_histogram_(const LatencyHistogramSnapshot& from, stats::LatencyHistogram& to)
+   {
+      for(std::size_t i = 0; i < k_number_latency_buckets; ++i) {
+         const auto bound = LatencyHistogramSnapshot::upper_bound(i);
+         to.add_bucket_upper_bound_ns(
+             bound == std::chrono::nanoseconds::max() ? 0 : static_cast<uint64_t>(bound.count()));
+         to.add_counts(from.counts[i]);
+      }
+      to.set_count(from.count);
+      to.set_sum_ns(static_cast<uint64_t>(from.sum.count()));
+   }
+
+   std::shared_ptr<const ServerMetrics> metrics_;
+};
+
+} // namespace sgrpc
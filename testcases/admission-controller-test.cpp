@@ -0,0 +1,100 @@
+
+#include "sgrpc/admission_controller.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Clock = sgrpc::AdmissionController::Clock;
+
+constexpr auto k_target   = 5ms;
+constexpr auto k_interval = 100ms;
+
+sgrpc::AdmissionController make_controller()
+{
+   return sgrpc::AdmissionController{{.target_delay = k_target, .interval = k_interval}};
+}
+
+//!< Every 1ms from `now`, for `duration`: a request arrives, and starts `delay` later
+int serve(sgrpc::AdmissionController& controller,
+          Clock::time_point& now,
+          std::chrono::nanoseconds duration,
+          std::chrono::nanoseconds delay)
+{
+   int admitted = 0;
+   for(const auto until = now + duration; now < until; now += 1ms)
+      if(controller.admit(now)) {
+         controller.record(delay, now);
+         ++admitted;
+      }
+   return admitted;
+}
+
+} // namespace
+
+TEST(AdmissionController, AdmitsWhileDelayIsBelowTarget)
+{
+   auto controller = make_controller();
+   auto now        = Clock::time_point{};
+   EXPECT_EQ(serve(controller, now, 1s, 1ms), 1000);
+
+   const auto stats = controller.stats();
+   EXPECT_EQ(stats.admitted, 1000u);
+   EXPECT_EQ(stats.shed, 0u);
+   EXPECT_FALSE(stats.is_overloaded);
+}
+
+TEST(AdmissionController, IgnoresBursts)
+{
+   auto controller = make_controller();
+   auto now        = Clock::time_point{};
+   for(int i = 0; i < 10; ++i) { // Each burst drains within an interval
+      EXPECT_EQ(serve(controller, now, 90ms, 50ms), 90);
+      serve(controller, now, 1ms, 1ms);
+   }
+   EXPECT_EQ(controller.stats().shed, 0u);
+   EXPECT_FALSE(controller.stats().is_overloaded);
+}
+
+TEST(AdmissionController, ShedsUnderAStandingQueue)
+{
+   auto controller = make_controller();
+   auto now        = Clock::time_point{};
+   EXPECT_EQ(serve(controller, now, 101ms, 50ms), 101); // A whole interval above target
+   EXPECT_TRUE(controller.stats().is_overloaded);
+
+   // Shed at an increasing rate, but never everything
+   const auto first  = 1000 - serve(controller, now, 1s, 50ms);
+   const auto second = 1000 - serve(controller, now, 1s, 50ms);
+   EXPECT_GT(first, 0);
+   EXPECT_GT(second, first);
+   EXPECT_LT(second, 1000);
+}
+
+TEST(AdmissionController, RecoversAsSoonAsTheBacklogDrains)
+{
+   auto controller = make_controller();
+   auto now        = Clock::time_point{};
+   serve(controller, now, 2s, 50ms);
+   ASSERT_TRUE(controller.stats().is_overloaded);
+
+   // The first request to start on time ends the overload; nothing more is shed
+   serve(controller, now, 1ms, 1ms);
+   EXPECT_FALSE(controller.stats().is_overloaded);
+   EXPECT_EQ(serve(controller, now, 1s, 1ms), 1000);
+}
+
+TEST(AdmissionController, DoesNotShedAnIdleServer)
+{
+   auto controller = make_controller();
+   auto now        = Clock::time_point{};
+   serve(controller, now, 2s, 50ms);
+   ASSERT_TRUE(controller.stats().is_overloaded);
+   serve(controller, now, 1ms, 1ms);
+
+   now += 10s; // Idle: no requests, so no samples
+   EXPECT_TRUE(controller.admit(now));
+}
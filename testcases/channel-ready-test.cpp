@@ -0,0 +1,123 @@
+
+#include "sgrpc/channel_ready.hpp"
+#include "sgrpc/detail/utils.hpp"
+#include "sgrpc/execution_context.hpp"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <optional>
+#include <thread>
+#include <variant>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct Ready
+{};
+struct Stopped
+{};
+using Outcome = std::variant<Ready, sgrpc::RpcStatus, Stopped>;
+
+//!< Delivers the outcome to a future; observes `stop_source`'s token
+struct OutcomeReceiver
+{
+   struct Env
+   {
+      stdexec::inplace_stop_source* stop_source_;
+
+      friend stdexec::inplace_stop_token tag_invoke(stdexec::get_stop_token_t,
+                                                    const Env& self) noexcept
+      {
+         return self.stop_source_->get_token();
+      }
+   };
+
+   std::promise<Outcome>* outcome_;
+   stdexec::inplace_stop_source* stop_source_;
+
+   friend void tag_invoke(stdexec::set_value_t, OutcomeReceiver&& self) noexcept
+   {
+      self.outcome_->set_value(Ready{});
+   }
+   friend void
+   tag_invoke(stdexec::set_error_t, OutcomeReceiver&& self, sgrpc::RpcStatus status) noexcept
+   {
+      self.outcome_->set_value(std::move(status));
+   }
+   friend void tag_invoke(stdexec::set_stopped_t, OutcomeReceiver&& self) noexcept
+   {
+      self.outcome_->set_value(Stopped{});
+   }
+   friend Env tag_invoke(stdexec::get_env_t, const OutcomeReceiver& self) noexcept
+   {
+      return {self.stop_source_};
+   }
+};
+
+//!< Nothing listens here, so the channel never becomes ready
+std::shared_ptr<grpc::Channel> make_unready_channel()
+{
+   return grpc::CreateChannel("localhost:1", grpc::InsecureChannelCredentials());
+}
+
+class ChannelReadyTest : public ::testing::Test
+{
+ protected:
+   ChannelReadyTest() { context_.run(); }
+
+   void start(std::shared_ptr<grpc::Channel> channel, std::chrono::nanoseconds timeout)
+   {
+      op_.emplace(sgrpc::detail::EmplaceFrom{[&]() {
+         return stdexec::connect(sgrpc::wait_until_ready(context_, std::move(channel), timeout),
+                                 OutcomeReceiver{&outcome_, &stop_source_});
+      }});
+      stdexec::start(*op_);
+   }
+
+   using OpState = stdexec::connect_result_t<sgrpc::ChannelReadySender, OutcomeReceiver>;
+
+   sgrpc::ExecutionContext context_{1, 1};
+   std::promise<Outcome> outcome_;
+   stdexec::inplace_stop_source stop_source_;
+   std::optional<OpState> op_;
+};
+
+} // namespace
+
+TEST_F(ChannelReadyTest, FailsAtTheDeadline)
+{
+   start(make_unready_channel(), 200ms);
+   const auto outcome = outcome_.get_future().get();
+   ASSERT_TRUE(std::holds_alternative<sgrpc::RpcStatus>(outcome));
+   EXPECT_EQ(std::get<sgrpc::RpcStatus>(outcome).error_code(),
+             sgrpc::RpcStatusCode::DeadlineExceeded);
+}
+
+TEST_F(ChannelReadyTest, StopsWhenRequested)
+{
+   start(make_unready_channel(), 1h);
+   std::this_thread::sleep_for(50ms);
+   stop_source_.request_stop();
+
+   auto future = outcome_.get_future();
+   ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+   EXPECT_TRUE(std::holds_alternative<Stopped>(future.get()));
+}
+
+TEST_F(ChannelReadyTest, ContextStopIsNotHeldUntilTheDeadline)
+{
+   start(make_unready_channel(), 1h);
+   std::this_thread::sleep_for(50ms);
+
+   const auto started = std::chrono::steady_clock::now();
+   context_.stop();
+   EXPECT_LT(std::chrono::steady_clock::now() - started, 5s);
+
+   const auto outcome = outcome_.get_future().get();
+   ASSERT_TRUE(std::holds_alternative<sgrpc::RpcStatus>(outcome));
+   EXPECT_EQ(std::get<sgrpc::RpcStatus>(outcome).error_code(),
+             sgrpc::RpcStatusCode::Unavailable);
+}
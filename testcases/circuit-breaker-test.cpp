@@ -0,0 +1,170 @@
+
+#include "sgrpc/circuit_breaker.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <latch>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+sgrpc::CircuitBreakerOptions fast_options()
+{
+   return {.window_size      = 10,
+           .minimum_calls    = 4,
+           .open_duration    = 10ms,
+           .half_open_probes = 2};
+}
+
+void record(sgrpc::CircuitBreaker& breaker, bool is_failure)
+{
+   auto permit = breaker.try_acquire();
+   ASSERT_TRUE(permit.has_value());
+   breaker.record(*permit, is_failure);
+}
+
+void open(sgrpc::CircuitBreaker& breaker)
+{
+   for(int i = 0; i < 4; ++i) record(breaker, true);
+   ASSERT_EQ(breaker.state(), sgrpc::CircuitState::Open);
+}
+
+void half_open(sgrpc::CircuitBreaker& breaker)
+{
+   open(breaker);
+   std::this_thread::sleep_for(15ms);
+}
+
+} // namespace
+
+TEST(CircuitBreaker, StaysClosedBelowMinimumCalls)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   for(int i = 0; i < 3; ++i) record(breaker, true);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::Closed);
+}
+
+TEST(CircuitBreaker, OpensAtTheFailureRate)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   record(breaker, false);
+   record(breaker, false);
+   record(breaker, true);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::Closed);
+   record(breaker, true); // 2 of 4 failed
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::Open);
+
+   EXPECT_FALSE(breaker.try_acquire().has_value());
+   EXPECT_EQ(breaker.stats().rejected, 1u);
+}
+
+TEST(CircuitBreaker, LimitsHalfOpenProbes)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   half_open(breaker);
+
+   auto first  = breaker.try_acquire();
+   auto second = breaker.try_acquire();
+   ASSERT_TRUE(first.has_value());
+   ASSERT_TRUE(second.has_value());
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+   EXPECT_FALSE(breaker.try_acquire().has_value());
+}
+
+TEST(CircuitBreaker, ClosesAfterProbeSuccesses)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   half_open(breaker);
+   record(breaker, false);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+   record(breaker, false);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::Closed);
+}
+
+TEST(CircuitBreaker, ReopensOnAProbeFailure)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   half_open(breaker);
+   record(breaker, false);
+   record(breaker, true);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::Open);
+}
+
+TEST(CircuitBreaker, ReleasedProbesDoNotClose)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   half_open(breaker);
+   for(int i = 0; i < 5; ++i) { // E.g., cancelled calls: they only free the slot
+      auto permit = breaker.try_acquire();
+      ASSERT_TRUE(permit.has_value());
+      breaker.release(*permit);
+   }
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+}
+
+TEST(CircuitBreaker, IgnoresStaleOutcomes)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   auto before = breaker.try_acquire(); // Issued while closed
+   ASSERT_TRUE(before.has_value());
+   half_open(breaker);
+   auto probe = breaker.try_acquire();
+   ASSERT_TRUE(probe.has_value());
+   ASSERT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+
+   breaker.record(*before, false);
+   breaker.record(*before, false);
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+}
+
+TEST(CircuitBreaker, NotifiesListeners)
+{
+   sgrpc::CircuitBreaker breaker{fast_options()};
+   std::vector<std::pair<sgrpc::CircuitState, sgrpc::CircuitState>> transitions;
+   breaker.add_listener([&](auto from, auto to) { transitions.emplace_back(from, to); });
+
+   half_open(breaker);
+   record(breaker, false);
+   record(breaker, false);
+
+   using enum sgrpc::CircuitState;
+   const std::vector<std::pair<sgrpc::CircuitState, sgrpc::CircuitState>> expected{
+       {Closed, Open}, {Open, HalfOpen}, {HalfOpen, Closed}};
+   EXPECT_EQ(transitions, expected);
+}
+
+TEST(CircuitBreaker, ProbeLimitHoldsWhileListenersRun)
+{
+   auto options             = fast_options();
+   options.half_open_probes = 1;
+   sgrpc::CircuitBreaker breaker{options};
+
+   // Holds the thread that moves the breaker to HalfOpen inside the listeners...
+   std::latch in_listener{1};
+   std::latch release_listener{1};
+   breaker.add_listener([&](auto, auto to) {
+      if(to != sgrpc::CircuitState::HalfOpen) return;
+      in_listener.count_down();
+      release_listener.wait();
+   });
+   half_open(breaker);
+
+   std::optional<sgrpc::CircuitBreaker::Permit> first;
+   std::thread prober{[&] { first = breaker.try_acquire(); }};
+   in_listener.wait();
+
+   // ...while another call races it, and fails if it gets a probe
+   auto second = breaker.try_acquire();
+   if(second.has_value()) breaker.record(*second, true);
+   release_listener.count_down();
+   prober.join();
+
+   EXPECT_NE(first.has_value(), second.has_value()); // Only one probe, ever
+   EXPECT_EQ(breaker.state(), sgrpc::CircuitState::HalfOpen);
+}
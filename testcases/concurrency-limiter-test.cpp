@@ -0,0 +1,125 @@
+
+#include "sgrpc/concurrency_limiter.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Admission = sgrpc::ConcurrencyLimiter::Admission;
+
+sgrpc::ConcurrencyLimiterOptions aimd_options(std::size_t initial_limit)
+{
+   return {.algorithm = sgrpc::LimitAlgorithm::Aimd, .initial_limit = initial_limit};
+}
+
+void fill(sgrpc::ConcurrencyLimiter& limiter, std::size_t n)
+{
+   for(std::size_t i = 0; i < n; ++i) ASSERT_EQ(limiter.acquire([] {}), Admission::Admitted);
+}
+
+} // namespace
+
+TEST(ConcurrencyLimiter, RejectsOverTheLimit)
+{
+   sgrpc::ConcurrencyLimiter limiter{aimd_options(2)};
+   fill(limiter, 2);
+   EXPECT_EQ(limiter.acquire([] {}), Admission::Rejected);
+
+   const auto stats = limiter.stats();
+   EXPECT_EQ(stats.in_flight, 2u);
+   EXPECT_EQ(stats.admitted, 2u);
+   EXPECT_EQ(stats.rejected, 1u);
+}
+
+TEST(ConcurrencyLimiter, QueuedCallsAreAdmittedInOrder)
+{
+   auto options             = aimd_options(1);
+   options.max_queue_length = 2;
+   sgrpc::ConcurrencyLimiter limiter{options};
+   fill(limiter, 1);
+
+   std::vector<int> admitted;
+   EXPECT_EQ(limiter.acquire([&] { admitted.push_back(1); }), Admission::Queued);
+   EXPECT_EQ(limiter.acquire([&] { admitted.push_back(2); }), Admission::Queued);
+   EXPECT_EQ(limiter.acquire([] {}), Admission::Rejected);
+
+   limiter.release(); // Without a sample, so that the limit stays at 1
+   EXPECT_EQ(admitted, std::vector<int>{1});
+   limiter.release();
+   EXPECT_EQ(admitted, (std::vector<int>{1, 2}));
+   EXPECT_EQ(limiter.stats().queue_length, 0u);
+}
+
+TEST(ConcurrencyLimiter, AimdBacksOffOnDrops)
+{
+   sgrpc::ConcurrencyLimiter limiter{aimd_options(10)};
+   fill(limiter, 10);
+   limiter.release(1ms, true);
+   EXPECT_EQ(limiter.stats().limit, 9u);
+}
+
+TEST(ConcurrencyLimiter, AimdBacksOffOnSlowCalls)
+{
+   auto options              = aimd_options(10);
+   options.latency_threshold = 100ms;
+   sgrpc::ConcurrencyLimiter limiter{options};
+   fill(limiter, 10);
+   limiter.release(200ms, false);
+   EXPECT_EQ(limiter.stats().limit, 9u);
+}
+
+TEST(ConcurrencyLimiter, AimdGrowsOnlyWhenTheLimitIsUsed)
+{
+   sgrpc::ConcurrencyLimiter limiter{aimd_options(10)};
+   fill(limiter, 1);
+   limiter.release(1ms, false); // 1 in flight of 10: says nothing about the limit
+   EXPECT_EQ(limiter.stats().limit, 10u);
+
+   fill(limiter, 10);
+   limiter.release(1ms, false);
+   EXPECT_EQ(limiter.stats().limit, 11u);
+}
+
+TEST(ConcurrencyLimiter, ReleaseWithoutASampleKeepsTheLimit)
+{
+   sgrpc::ConcurrencyLimiter limiter{aimd_options(10)};
+   fill(limiter, 10);
+   for(int i = 0; i < 10; ++i) limiter.release();
+
+   const auto stats = limiter.stats();
+   EXPECT_EQ(stats.limit, 10u);
+   EXPECT_EQ(stats.in_flight, 0u);
+}
+
+TEST(ConcurrencyLimiter, GradientShrinksWhenLatencyRises)
+{
+   sgrpc::ConcurrencyLimiter limiter{{.initial_limit = 100, .long_window = 1000}};
+   fill(limiter, 100);
+   for(int i = 0; i < 50; ++i) limiter.release(1ms, false); // Establishes the baseline
+   const auto baseline = limiter.stats().limit;
+
+   fill(limiter, limiter.stats().limit - limiter.stats().in_flight);
+   for(int i = 0; i < 20; ++i) limiter.release(20ms, false);
+   EXPECT_LT(limiter.stats().limit, baseline);
+}
+
+TEST(ConcurrencyLimiter, StaysWithinBounds)
+{
+   sgrpc::ConcurrencyLimiter limiter{
+       {.algorithm = sgrpc::LimitAlgorithm::Aimd, .initial_limit = 2, .min_limit = 2}};
+   fill(limiter, 2);
+   limiter.release(1ms, true);
+   limiter.release(1ms, true);
+   EXPECT_EQ(limiter.stats().limit, 2u);
+}
+
+TEST(ConcurrencyLimiter, RejectsInvalidBounds)
+{
+   EXPECT_THROW(sgrpc::ConcurrencyLimiter({.min_limit = 10, .max_limit = 5}),
+                std::invalid_argument);
+   EXPECT_THROW(sgrpc::ConcurrencyLimiter({.max_limit = 0}), std::invalid_argument);
+   EXPECT_NO_THROW(sgrpc::ConcurrencyLimiter({.min_limit = 0, .max_limit = 1}));
+}
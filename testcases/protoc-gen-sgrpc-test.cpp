@@ -0,0 +1,104 @@
+
+#include "protos/sgrpc_plugin_test.sgrpc.pb.h"
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+
+using RouteGuide = sgrpc_plugin_test::RouteGuideSgrpc;
+using Point      = sgrpc_plugin_test::Point;
+using Feature    = sgrpc_plugin_test::Feature;
+using Summary    = sgrpc_plugin_test::Feature_Summary;
+using Client     = RouteGuide::Client;
+
+// A client member, of the right kind, for every method
+static_assert(std::is_same_v<decltype(std::declval<Client&>().get_feature(Point{})),
+                             sgrpc::PureClientRpcSender<RouteGuide::Stub, Point, Summary>>);
+static_assert(std::is_same_v<decltype(std::declval<Client&>().delete_(Point{})),
+                             sgrpc::PureClientRpcSender<RouteGuide::Stub, Point, Point>>);
+static_assert(std::is_same_v<decltype(std::declval<Client&>().list_features(Point{})),
+                             sgrpc::ClientReader<Point, Feature>>);
+static_assert(std::is_same_v<decltype(std::declval<Client&>().record_route()),
+                             sgrpc::ClientWriter<Point, Summary>>);
+static_assert(std::is_same_v<decltype(std::declval<Client&>().route_chat()),
+                             sgrpc::ClientReaderWriter<Point, Point>>);
+
+//!< Serves the unary methods, by their snake_case names
+struct Logic
+{
+   Summary get_feature(const grpc::ServerContextBase&, const Point& point)
+   {
+      Summary summary;
+      summary.set_point_count(point.latitude() + point.longitude());
+      return summary;
+   }
+
+   Point delete_(const grpc::ServerContextBase&, const Point& point) { return point; }
+};
+
+using Server = RouteGuide::Server<Logic>;
+
+// Options only for the unary methods
+static_assert(std::is_same_v<decltype(Server::MethodOptions::get_feature),
+                             sgrpc::ServerMethodOptions>);
+static_assert(std::is_same_v<decltype(Server::MethodOptions::delete_),
+                             sgrpc::ServerMethodOptions>);
+
+Point make_point(int latitude, int longitude)
+{
+   Point point;
+   point.set_latitude(latitude);
+   point.set_longitude(longitude);
+   return point;
+}
+
+//!< Calls both unary methods, and a streaming one, through `channel`
+void expect_served(sgrpc::ExecutionContext& context, std::shared_ptr<grpc::Channel> channel)
+{
+   Client client{context, channel};
+
+   auto [summary] = stdexec::sync_wait(client.get_feature(make_point(2, 3))).value();
+   EXPECT_EQ(summary.point_count(), 5);
+
+   auto [point] = stdexec::sync_wait(client.delete_(make_point(7, 11))).value();
+   EXPECT_EQ(point.latitude(), 7);
+   EXPECT_EQ(point.longitude(), 11);
+
+   auto stream = client.record_route();
+   try {
+      stdexec::sync_wait(stream.finish());
+      ADD_FAILURE() << "streaming methods are not served";
+   } catch(const sgrpc::RpcStatus& status) {
+      EXPECT_EQ(status.error_code(), sgrpc::RpcStatusCode::Unimplemented);
+   }
+}
+
+} // namespace
+
+TEST(ProtocGenSgrpc, ServesWithTheCompletionQueueBackend)
+{
+   sgrpc::ExecutionContext context{2, 1};
+   auto container = Server::make(context, std::make_shared<Logic>());
+   context.run();
+
+   expect_served(context, container->in_process_channel());
+
+   container->shutdown();
+   context.stop();
+}
+
+TEST(ProtocGenSgrpc, ServesWithTheCallbackBackend)
+{
+   sgrpc::ExecutionContext context{2, 1};
+   auto container = Server::make_callback(context, std::make_shared<Logic>());
+   context.run();
+
+   expect_served(context, container->in_process_channel());
+
+   container->shutdown();
+   context.stop();
+}
@@ -0,0 +1,272 @@
+
+#include "sgrpc/execution_context.hpp"
+#include "sgrpc/retry.hpp"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <future>
+#include <mutex>
+#include <variant>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/**
+ * A sender whose attempts fail with the scripted statuses, in order, and then succeed with
+ * the number of attempts made. Completes on the context, as an rpc sender does.
+ */
+struct ScriptedSender
+{
+   struct Script
+   {
+      std::mutex padlock;
+      std::deque<sgrpc::RpcStatusCode> failures;
+      int attempts{0};
+   };
+
+   template<typename Receiver> struct OpState
+   {
+      sgrpc::ExecutionContext* context_;
+      std::shared_ptr<Script> script_;
+      Receiver receiver_;
+
+      friend void tag_invoke(stdexec::start_t, OpState& self) noexcept
+      {
+         self.context_->post([&self]() {
+            std::unique_lock lock{self.script_->padlock};
+            const int attempts = ++self.script_->attempts;
+            if(self.script_->failures.empty()) {
+               lock.unlock();
+               stdexec::set_value(std::move(self.receiver_), attempts);
+               return;
+            }
+            const auto code = self.script_->failures.front();
+            self.script_->failures.pop_front();
+            lock.unlock();
+            stdexec::set_error(std::move(self.receiver_), sgrpc::RpcStatus{code});
+         });
+      }
+   };
+
+   using completion_signatures
+       = stdexec::completion_signatures<stdexec::set_value_t(int),
+                                        stdexec::set_error_t(sgrpc::RpcStatus)>;
+
+   template<typename Receiver>
+   friend auto tag_invoke(stdexec::connect_t, ScriptedSender self, Receiver&& receiver)
+   {
+      return OpState<std::remove_cvref_t<Receiver>>{
+          self.context_, self.script_, std::forward<Receiver>(receiver)};
+   }
+
+   friend sgrpc::Scheduler tag_invoke(stdexec::get_completion_scheduler_t<stdexec::set_value_t>,
+                                      const ScriptedSender& self) noexcept
+   {
+      return sgrpc::Scheduler{*self.context_};
+   }
+
+   sgrpc::ExecutionContext* context_;
+   std::shared_ptr<Script> script_;
+};
+
+struct Stopped
+{};
+using Outcome = std::variant<int, sgrpc::RpcStatus, Stopped>;
+
+//!< Delivers the outcome to a future; observes `stop_source`'s token
+struct OutcomeReceiver
+{
+   struct Env
+   {
+      stdexec::inplace_stop_source* stop_source_;
+
+      friend stdexec::inplace_stop_token tag_invoke(stdexec::get_stop_token_t,
+                                                    const Env& self) noexcept
+      {
+         return self.stop_source_->get_token();
+      }
+   };
+
+   std::promise<Outcome>* outcome_;
+   stdexec::inplace_stop_source* stop_source_;
+
+   friend void tag_invoke(stdexec::set_value_t, OutcomeReceiver&& self, int attempts) noexcept
+   {
+      self.outcome_->set_value(attempts);
+   }
+   friend void
+   tag_invoke(stdexec::set_error_t, OutcomeReceiver&& self, sgrpc::RpcStatus status) noexcept
+   {
+      self.outcome_->set_value(std::move(status));
+   }
+   friend void tag_invoke(stdexec::set_stopped_t, OutcomeReceiver&& self) noexcept
+   {
+      self.outcome_->set_value(Stopped{});
+   }
+   friend Env tag_invoke(stdexec::get_env_t, const OutcomeReceiver& self) noexcept
+   {
+      return {self.stop_source_};
+   }
+};
+
+class RetryOpStateTest : public ::testing::Test
+{
+ protected:
+   RetryOpStateTest() { context_.run(); }
+
+   //!< Runs `retry(...)` over `failures` to its outcome
+   Outcome run(std::deque<sgrpc::RpcStatusCode> failures, sgrpc::RetryPolicy policy)
+   {
+      script_->failures = std::move(failures);
+      auto op = stdexec::connect(sgrpc::retry(ScriptedSender{&context_, script_}, policy),
+                                 OutcomeReceiver{&outcome_, &stop_source_});
+      stdexec::start(op);
+      return outcome_.get_future().get();
+   }
+
+   sgrpc::ExecutionContext context_{2, 1};
+   std::shared_ptr<ScriptedSender::Script> script_ = std::make_shared<ScriptedSender::Script>();
+   std::promise<Outcome> outcome_;
+   stdexec::inplace_stop_source stop_source_;
+};
+
+constexpr auto k_unavailable = sgrpc::RpcStatusCode::Unavailable;
+
+sgrpc::RetryPolicy fast_policy(unsigned max_attempts)
+{
+   return {.max_attempts = max_attempts, .initial_backoff = 1ms, .max_backoff = 1ms};
+}
+
+// A stop request during a backoff completes with `set_stopped`
+static_assert(std::is_same_v<
+              sgrpc::RetrySender<ScriptedSender>::completion_signatures,
+              stdexec::completion_signatures<stdexec::set_value_t(int),
+                                             stdexec::set_error_t(sgrpc::RpcStatus),
+                                             stdexec::set_stopped_t()>>);
+
+} // namespace
+
+TEST_F(RetryOpStateTest, RetriesAfterAnError)
+{
+   const auto outcome = run({k_unavailable, k_unavailable}, fast_policy(3));
+   ASSERT_TRUE(std::holds_alternative<int>(outcome));
+   EXPECT_EQ(std::get<int>(outcome), 3);
+}
+
+TEST_F(RetryOpStateTest, FailsAfterMaxAttempts)
+{
+   auto policy    = fast_policy(2);
+   policy.metrics = std::make_shared<sgrpc::RetryMetrics>();
+   const auto outcome = run({k_unavailable, k_unavailable, k_unavailable}, policy);
+   ASSERT_TRUE(std::holds_alternative<sgrpc::RpcStatus>(outcome));
+   EXPECT_EQ(std::get<sgrpc::RpcStatus>(outcome).error_code(), k_unavailable);
+   EXPECT_EQ(script_->attempts, 2);
+   EXPECT_EQ(policy.metrics->attempts_exhausted.load(), 1u);
+}
+
+TEST_F(RetryOpStateTest, DoesNotRetryOtherCodes)
+{
+   const auto outcome = run({sgrpc::RpcStatusCode::InvalidArgument}, fast_policy(3));
+   ASSERT_TRUE(std::holds_alternative<sgrpc::RpcStatus>(outcome));
+   EXPECT_EQ(script_->attempts, 1);
+}
+
+TEST_F(RetryOpStateTest, StopsWhenTheBudgetRunsOut)
+{
+   auto policy    = fast_policy(10);
+   policy.budget  = std::make_shared<sgrpc::RetryBudget>(4.0, 0.1); // Retries while > 2
+   policy.metrics = std::make_shared<sgrpc::RetryMetrics>();
+   const auto outcome = run({k_unavailable, k_unavailable, k_unavailable, k_unavailable}, policy);
+   ASSERT_TRUE(std::holds_alternative<sgrpc::RpcStatus>(outcome));
+   EXPECT_EQ(script_->attempts, 2); // 4 -> 3 (retry) -> 2 (denied)
+   EXPECT_EQ(policy.metrics->budget_exhausted.load(), 1u);
+}
+
+TEST_F(RetryOpStateTest, StopCancelsTheBackoff)
+{
+   auto policy            = fast_policy(3);
+   policy.initial_backoff = policy.max_backoff = 1h;
+   script_->failures                           = {k_unavailable};
+   auto op = stdexec::connect(sgrpc::retry(ScriptedSender{&context_, script_}, policy),
+                              OutcomeReceiver{&outcome_, &stop_source_});
+   stdexec::start(op);
+
+   // Wait for the first attempt to fail, and the backoff to start
+   while(true) {
+      std::this_thread::sleep_for(1ms);
+      std::lock_guard lock{script_->padlock};
+      if(script_->attempts == 1) break;
+   }
+   stop_source_.request_stop(); // Whether or not the backoff has started yet
+
+   auto future = outcome_.get_future();
+   ASSERT_EQ(future.wait_for(5s), std::future_status::ready); // Not after an hour
+   EXPECT_TRUE(std::holds_alternative<Stopped>(future.get()));
+   EXPECT_EQ(script_->attempts, 1);
+}
+
+TEST(RetryBudget, StartsFull)
+{
+   sgrpc::RetryBudget budget{10.0, 0.1};
+   EXPECT_TRUE(budget.can_retry());
+   EXPECT_DOUBLE_EQ(budget.tokens(), 10.0);
+}
+
+TEST(RetryBudget, FailuresExhaustItAtHalf)
+{
+   sgrpc::RetryBudget budget{10.0, 0.1};
+   for(int i = 0; i < 4; ++i) budget.record_failure();
+   EXPECT_TRUE(budget.can_retry()); // 6 > 5
+   budget.record_failure();
+   EXPECT_FALSE(budget.can_retry()); // 5 is not more than half
+}
+
+TEST(RetryBudget, SuccessesRefillIt)
+{
+   sgrpc::RetryBudget budget{10.0, 0.5};
+   for(int i = 0; i < 5; ++i) budget.record_failure();
+   ASSERT_FALSE(budget.can_retry());
+   budget.record_success();
+   EXPECT_TRUE(budget.can_retry());
+   EXPECT_DOUBLE_EQ(budget.tokens(), 5.5);
+}
+
+TEST(RetryBudget, StaysWithinBounds)
+{
+   sgrpc::RetryBudget budget{2.0, 1.0};
+   for(int i = 0; i < 10; ++i) budget.record_success();
+   EXPECT_DOUBLE_EQ(budget.tokens(), 2.0);
+   for(int i = 0; i < 10; ++i) budget.record_failure();
+   EXPECT_DOUBLE_EQ(budget.tokens(), 0.0);
+}
+
+TEST(RetryPolicy, BackoffGrowsToTheCap)
+{
+   const sgrpc::RetryPolicy policy{
+       .initial_backoff = 10ms, .max_backoff = 50ms, .backoff_multiplier = 2.0, .jitter = 0.0};
+   EXPECT_EQ(policy.backoff(1), 10ms);
+   EXPECT_EQ(policy.backoff(2), 20ms);
+   EXPECT_EQ(policy.backoff(3), 40ms);
+   EXPECT_EQ(policy.backoff(4), 50ms);
+   EXPECT_EQ(policy.backoff(10), 50ms);
+}
+
+TEST(RetryPolicy, JitterStaysInRange)
+{
+   const sgrpc::RetryPolicy policy{.initial_backoff = 100ms, .jitter = 0.2};
+   for(int i = 0; i < 100; ++i) {
+      const auto backoff = policy.backoff(1);
+      EXPECT_GE(backoff, 80ms);
+      EXPECT_LE(backoff, 120ms);
+   }
+}
+
+TEST(RetryPolicy, OnlyRetriesListedCodes)
+{
+   const sgrpc::RetryPolicy policy{};
+   EXPECT_TRUE(policy.is_retryable(sgrpc::RpcStatusCode::Unavailable));
+   EXPECT_FALSE(policy.is_retryable(sgrpc::RpcStatusCode::InvalidArgument));
+}
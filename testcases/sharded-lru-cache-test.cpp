@@ -0,0 +1,109 @@
+
+#include "sgrpc/detail/sharded_lru_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Cache = sgrpc::detail::ShardedLruCache<std::string>;
+
+//!< The bytes one entry with a 1-char key and `value_bytes` value is charged
+std::size_t entry_bytes(std::size_t value_bytes)
+{
+   Cache cache{1, 1 << 20, 1min};
+   cache.insert("k", "", value_bytes);
+   return cache.stats().bytes;
+}
+
+} // namespace
+
+TEST(ShardedLruCache, FindsWhatWasInserted)
+{
+   Cache cache{4, 1 << 20, 1min};
+   cache.insert("a", "apple", 5);
+   cache.insert("b", "banana", 6);
+
+   EXPECT_EQ(cache.find("a"), "apple");
+   EXPECT_EQ(cache.find("b"), "banana");
+   EXPECT_EQ(cache.find("c"), std::nullopt);
+
+   const auto stats = cache.stats();
+   EXPECT_EQ(stats.hits, 2u);
+   EXPECT_EQ(stats.misses, 1u);
+   EXPECT_EQ(stats.entries, 2u);
+   EXPECT_DOUBLE_EQ(stats.hit_rate(), 2.0 / 3.0);
+}
+
+TEST(ShardedLruCache, InsertReplaces)
+{
+   Cache cache{1, 1 << 20, 1min};
+   cache.insert("a", "apple", 5);
+   cache.insert("a", "apricot", 7);
+   EXPECT_EQ(cache.find("a"), "apricot");
+   EXPECT_EQ(cache.stats().entries, 1u);
+}
+
+TEST(ShardedLruCache, EvictsTheColdestEntry)
+{
+   const auto bytes = entry_bytes(100);
+   Cache cache{1, 3 * bytes, 1min}; // Room for three entries
+   cache.insert("a", "", 100);
+   cache.insert("b", "", 100);
+   cache.insert("c", "", 100);
+   ASSERT_TRUE(cache.find("a").has_value()); // `b` is now the coldest
+
+   cache.insert("d", "", 100);
+   EXPECT_TRUE(cache.find("a").has_value());
+   EXPECT_FALSE(cache.find("b").has_value());
+   EXPECT_TRUE(cache.find("c").has_value());
+   EXPECT_TRUE(cache.find("d").has_value());
+   EXPECT_EQ(cache.stats().evictions, 1u);
+}
+
+TEST(ShardedLruCache, DoesNotCacheOversizedValues)
+{
+   Cache cache{1, 1024, 1min};
+   cache.insert("a", "", 4096);
+   EXPECT_FALSE(cache.find("a").has_value());
+   EXPECT_EQ(cache.stats().bytes, 0u);
+}
+
+TEST(ShardedLruCache, ExpiresAfterTheTtl)
+{
+   Cache cache{1, 1 << 20, 5ms};
+   cache.insert("a", "apple", 5);
+   ASSERT_TRUE(cache.find("a").has_value());
+
+   std::this_thread::sleep_for(10ms);
+   EXPECT_FALSE(cache.find("a").has_value());
+   const auto stats = cache.stats();
+   EXPECT_EQ(stats.expirations, 1u);
+   EXPECT_EQ(stats.entries, 0u);
+}
+
+TEST(ShardedLruCache, ChargesTheMemoryBudget)
+{
+   auto budget = std::make_shared<sgrpc::MemoryBudget>(entry_bytes(100) * 2, "test", 0.0);
+   {
+      Cache cache{1, 1 << 20, 1min, budget};
+      cache.insert("a", "", 100);
+      cache.insert("b", "", 100);
+      EXPECT_EQ(budget->used(), cache.stats().bytes);
+
+      cache.insert("c", "", 100); // The budget is spent: not cached
+      EXPECT_FALSE(cache.find("c").has_value());
+      EXPECT_EQ(budget->stats().rejected, 1u);
+
+      cache.clear();
+      EXPECT_EQ(budget->used(), 0u);
+      cache.insert("c", "", 100);
+      EXPECT_TRUE(cache.find("c").has_value());
+   }
+   EXPECT_EQ(budget->used(), 0u); // Given back on destruction
+}
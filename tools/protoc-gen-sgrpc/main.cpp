@@ -0,0 +1,453 @@
+
+/**
+ * protoc-gen-sgrpc: generates statically typed sgrpc clients and servers.
+ *
+ * For each `foo.proto`, emits the header-only `foo.sgrpc.pb.h`, next to grpc's `foo.grpc.pb.h`:
+ * ~~~
+ * protoc --plugin=protoc-gen-sgrpc=<path> --sgrpc_out=<gen-dir> protos/foo.proto
+ * ~~~
+ *
+ * For each service `Foo`, the header has a `FooSgrpc` with:
+ *  - `Client`: a member function per method, returning a `PureClientRpcSender` (unary),
+ *    `ClientReader`, `ClientWriter` or `ClientReaderWriter` (streaming).
+ *  - `Server<Logic>`: wires each unary method to the member function of `Logic` with the same
+ *    (snake_case) name, through a `ServerRpcHandler` whose request and logic functors are
+ *    generated, so there is no `std::bind` or `std::function` on the path of a call. The
+ *    methods are raw (grpc's `WithRawMethod_`), so that cached responses are written as they
+ *    were serialized. Builds either backend's container.
+ *
+ * sgrpc has no server-side streaming handlers: the streaming methods of a generated server are
+ * left to grpc's synchronous service, which answers them with `UNIMPLEMENTED`.
+ *
+ * A method whose snake_case name clashes, e.g., `Context` with `Client::context()`, fails the
+ * generation. testcases/protoc-gen-sgrpc-test.cpp compiles against the output for
+ * protos/sgrpc_plugin_test.proto, which has every kind of method.
+ */
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/plugin.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <cctype>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+namespace pb = google::protobuf;
+
+using Variables = std::map<std::string, std::string>;
+
+// ------------------------------------------------------------------------------------------ Naming
+
+std::string replace_all(std::string s, const std::string& from, const std::string& to)
+{
+   for(auto pos = s.find(from); pos != std::string::npos; pos = s.find(from, pos + to.size()))
+      s.replace(pos, from.size(), to);
+   return s;
+}
+
+//!< "protos/foo.proto" => "protos/foo"
+std::string strip_proto(const std::string& filename)
+{
+   constexpr std::string_view suffix = ".proto";
+   return filename.ends_with(suffix) ? filename.substr(0, filename.size() - suffix.size())
+                                     : filename;
+}
+
+//!< "a.b" => "::a::b", as protoc's C++ generator does
+std::string qualified_namespace(const pb::FileDescriptor& file)
+{
+   return file.package().empty() ? std::string{} : "::" + replace_all(file.package(), ".", "::");
+}
+
+//!< "a.b.Outer.Inner" => "::a::b::Outer_Inner"
+std::string qualified_class_name(const pb::Descriptor& message)
+{
+   const auto& package = message.file()->package();
+   auto name           = message.full_name().substr(package.empty() ? 0 : package.size() + 1);
+   return qualified_namespace(*message.file()) + "::" + replace_all(name, ".", "_");
+}
+
+bool is_keyword(const std::string& name)
+{
+   static const std::set<std::string> keywords{
+       "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break",
+       "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept",
+       "const", "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await",
+       "co_return", "co_yield", "decltype", "default", "delete", "do", "double", "dynamic_cast",
+       "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+       "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+       "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+       "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static",
+       "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local",
+       "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+       "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+   return keywords.contains(name);
+}
+
+/**
+ * "SayHello" => "say_hello", "GetHTTPStatus" => "get_http_status"; keywords get a trailing
+ * underscore, e.g., "Delete" => "delete_"
+ */
+std::string snake_case(const std::string& name)
+{
+   std::string out;
+   for(std::size_t i = 0; i < name.size(); ++i) {
+      const auto c = static_cast<unsigned char>(name[i]);
+      if(std::isupper(c) && i > 0) {
+         const auto prev = static_cast<unsigned char>(name[i - 1]);
+         const bool next_is_lower
+             = i + 1 < name.size() && std::islower(static_cast<unsigned char>(name[i + 1]));
+         if(std::islower(prev) || std::isdigit(prev) || (std::isupper(prev) && next_is_lower))
+            out += '_';
+      }
+      out += static_cast<char>(std::tolower(c));
+   }
+   return is_keyword(out) ? out + "_" : out;
+}
+
+// --------------------------------------------------------------------------------------- Generator
+
+bool is_unary(const pb::MethodDescriptor& method)
+{
+   return !method.client_streaming() && !method.server_streaming();
+}
+
+Variables method_variables(const pb::MethodDescriptor& method)
+{
+   return {{"Method", method.name()},
+           {"method", snake_case(method.name())},
+           {"Request", qualified_class_name(*method.input_type())},
+           {"Response", qualified_class_name(*method.output_type())},
+           {"path", "/" + method.service()->full_name() + "/" + method.name()}};
+}
+
+/**
+ * Each method becomes a member of `Client` (and a field of `MethodOptions`) named in
+ * snake_case, so it must not clash with `Client`'s own members, or with another method,
+ * e.g., "GetHTTP" and "GetHttp". Sets `error` if one does.
+ */
+bool check_method_names(const pb::ServiceDescriptor& service, std::string* error)
+{
+   static const std::set<std::string> client_members{"context", "grpc_stub", "context_", "stub_"};
+   std::map<std::string, std::string> methods; // snake_case => proto name
+   for(int i = 0; i < service.method_count(); ++i) {
+      const auto& name  = service.method(i)->name();
+      const auto member = snake_case(name);
+      const auto clash  = client_members.contains(member)
+                              ? "a member of the generated client"
+                              : (methods.contains(member) ? "method " + methods[member] : "");
+      if(!clash.empty()) {
+         *error = service.full_name() + "." + name + ": generated as `" + member
+                  + "`, which clashes with " + clash;
+         return false;
+      }
+      methods.emplace(member, name);
+   }
+   return true;
+}
+
+//!< Unary methods are raw (async); the rest stay with the synchronous `Service`
+std::string service_type(const pb::ServiceDescriptor& service, const std::string& grpc_class)
+{
+   std::string prefix, suffix;
+   for(int i = 0; i < service.method_count(); ++i) {
+      const auto& method = *service.method(i);
+      if(!is_unary(method)) continue;
+      prefix += grpc_class + "::WithRawMethod_" + method.name() + "<";
+      suffix += ">";
+   }
+   return prefix + grpc_class + "::Service" + suffix;
+}
+
+void print_client(pb::io::Printer& printer, const pb::ServiceDescriptor& service)
+{
+   printer.Print(R"(
+   /**
+    * A sender (or stream) for each method, with no type erasure: unary calls complete with
+    * the response itself, or a `grpc::Status` error.
+    */
+   class Client
+   {
+    public:
+      Client(::sgrpc::ExecutionContext& context,
+             const std::shared_ptr<::grpc::ChannelInterface>& channel)
+          : context_{context}
+          , stub_{Grpc::NewStub(channel)}
+      {}
+
+      ::sgrpc::ExecutionContext& context() const noexcept { return context_; }
+      Stub& grpc_stub() noexcept { return *stub_; }
+)");
+
+   for(int i = 0; i < service.method_count(); ++i) {
+      const auto& method = *service.method(i);
+      const auto vars    = method_variables(method);
+      if(is_unary(method)) {
+         printer.Print(vars, R"(
+      //!< `$Method$`
+      ::sgrpc::PureClientRpcSender<Stub, $Request$, $Response$>
+      $method$($Request$ request, ::sgrpc::ClientCallOptions options = {})
+      {
+         return {context_,
+                 {*stub_, &Stub::PrepareAsync$Method$},
+                 std::move(request),
+                 std::move(options)};
+      }
+)");
+      } else if(method.server_streaming() && !method.client_streaming()) {
+         printer.Print(vars, R"(
+      //!< `$Method$` (server streaming); at most `read_ahead` responses are buffered
+      ::sgrpc::ClientReader<$Request$, $Response$>
+      $method$($Request$ request, std::size_t read_ahead = 16)
+      {
+         return ::sgrpc::ClientReaderStub<Stub, $Request$, $Response$>{
+             *stub_, &Stub::PrepareAsync$Method$}
+             .call(context_, std::move(request), read_ahead);
+      }
+)");
+      } else if(method.client_streaming() && !method.server_streaming()) {
+         printer.Print(vars, R"(
+      //!< `$Method$` (client streaming)
+      ::sgrpc::ClientWriter<$Request$, $Response$> $method$()
+      {
+         return ::sgrpc::ClientWriterStub<Stub, $Request$, $Response$>{
+             *stub_, &Stub::PrepareAsync$Method$}
+             .call(context_);
+      }
+)");
+      } else {
+         printer.Print(vars, R"(
+      //!< `$Method$` (bidirectional streaming); at most `read_ahead` responses are buffered
+      ::sgrpc::ClientReaderWriter<$Request$, $Response$>
+      $method$(std::size_t read_ahead = 16)
+      {
+         return ::sgrpc::ClientReaderWriterStub<Stub, $Request$, $Response$>{
+             *stub_, &Stub::PrepareAsync$Method$}
+             .call(context_, read_ahead);
+      }
+)");
+      }
+   }
+
+   printer.Print(R"(
+    private:
+      ::sgrpc::ExecutionContext& context_;
+      std::unique_ptr<Stub> stub_;
+   };
+)");
+}
+
+void print_server(pb::io::Printer& printer, const pb::ServiceDescriptor& service)
+{
+   printer.Print(R"(
+   /**
+    * Serves the unary methods with the member functions of `Logic` of the same (snake_case)
+    * names, which take the arguments of a `ServerRpcHandler`'s logic, e.g.,
+    * ~~~
+    * Response method(const grpc::ServerContextBase& server_context, const Request& request);
+    * ~~~
+    * (or return a sender). Streaming methods are answered with `UNIMPLEMENTED`.
+    */
+   template<typename Logic> struct Server
+   {
+      using Container         = ::sgrpc::GenericServerContainer<Service, Logic>;
+      using CallbackContainer = ::sgrpc::CallbackServerContainer<Logic>;
+
+      //!< Per-method options
+      struct MethodOptions
+      {)");
+   for(int i = 0; i < service.method_count(); ++i)
+      if(is_unary(*service.method(i)))
+         printer.Print(method_variables(*service.method(i)), R"(
+         ::sgrpc::ServerMethodOptions $method$;)");
+   printer.Print(R"(
+      };
+)");
+
+   for(int i = 0; i < service.method_count(); ++i) {
+      const auto& method = *service.method(i);
+      if(!is_unary(method)) continue;
+      printer.Print(method_variables(method), R"(
+      //@{ `$Method$`: requests the next call, and runs the logic
+      struct BindRequest_$Method$
+      {
+         Service* service;
+         void operator()(::grpc::ServerContext* server_context,
+                         ::grpc::ByteBuffer* request,
+                         ::grpc::ServerAsyncResponseWriter<::grpc::ByteBuffer>* responder,
+                         ::grpc::ServerCompletionQueue* new_call_cq,
+                         ::grpc::ServerCompletionQueue* notification_cq,
+                         void* tag) const
+         {
+            service->Request$Method$(
+                server_context, request, responder, new_call_cq, notification_cq, tag);
+         }
+      };
+
+      struct Logic_$Method$
+      {
+         Logic* logic;
+         decltype(auto) operator()(const ::grpc::ServerContextBase& server_context,
+                                   const $Request$& request) const
+         {
+            return logic->$method$(server_context, request);
+         }
+      };
+      //@}
+)");
+   }
+
+   printer.Print(R"(
+      //!< Wires every unary method on `cq`, like a hand-written `wire_rpcs`
+      static void wire_rpcs([[maybe_unused]] Logic& logic,
+                            [[maybe_unused]] Service& service,
+                            [[maybe_unused]] ::sgrpc::Scheduler scheduler,
+                            [[maybe_unused]] ::grpc::ServerCompletionQueue& cq,
+                            [[maybe_unused]] const MethodOptions& options = {})
+      {)");
+   for(int i = 0; i < service.method_count(); ++i)
+      if(is_unary(*service.method(i)))
+         printer.Print(method_variables(*service.method(i)), R"(
+         new ::sgrpc::ServerRpcHandler<$Request$,
+                                       $Response$,
+                                       BindRequest_$Method$,
+                                       Logic_$Method$>(
+             scheduler,
+             "$path$",
+             BindRequest_$Method${&service},
+             Logic_$Method${&logic},
+             cq,
+             options.$method$);)");
+   printer.Print(R"(
+      }
+
+      //!< Wires every unary method for the `Callback` backend
+      static void wire_callback_rpcs([[maybe_unused]] Logic& logic,
+                                     [[maybe_unused]] ::sgrpc::CallbackMethodRouter& router,
+                                     [[maybe_unused]] const MethodOptions& options = {})
+      {)");
+   for(int i = 0; i < service.method_count(); ++i)
+      if(is_unary(*service.method(i)))
+         printer.Print(method_variables(*service.method(i)), R"(
+         router.add_unary<$Request$, $Response$>(
+             "$path$", Logic_$Method${&logic}, options.$method$);)");
+   printer.Print(R"(
+      }
+
+      static std::shared_ptr<Container> make(::sgrpc::ExecutionContext& context,
+                                             std::shared_ptr<Logic> logic,
+                                             ::sgrpc::ServerOptions options = {},
+                                             MethodOptions method_options = {})
+      {
+         return Container::make(
+             context,
+             std::move(logic),
+             [method_options = std::move(method_options)](Logic& instance,
+                                                          Service& service,
+                                                          ::sgrpc::Scheduler scheduler,
+                                                          ::grpc::ServerCompletionQueue& cq) {
+                wire_rpcs(instance, service, scheduler, cq, method_options);
+             },
+             std::move(options));
+      }
+
+      static std::shared_ptr<CallbackContainer>
+      make_callback(::sgrpc::ExecutionContext& context,
+                    std::shared_ptr<Logic> logic,
+                    ::sgrpc::ServerOptions options = {},
+                    MethodOptions method_options = {})
+      {
+         return CallbackContainer::make(
+             context,
+             std::move(logic),
+             [method_options = std::move(method_options)](Logic& instance,
+                                                          ::sgrpc::CallbackMethodRouter& router) {
+                wire_callback_rpcs(instance, router, method_options);
+             },
+             std::move(options));
+      }
+   };
+)");
+}
+
+void print_service(pb::io::Printer& printer, const pb::ServiceDescriptor& service)
+{
+   const auto grpc_class = qualified_namespace(*service.file()) + "::" + service.name();
+   printer.Print(Variables{{"Service", service.name()},
+                  {"full_name", service.full_name()},
+                  {"Grpc", grpc_class},
+                  {"RawService", service_type(service, grpc_class)}},
+                 R"(
+/**
+ * sgrpc client and server of `$full_name$`
+ */
+struct $Service$Sgrpc
+{
+   using Grpc    = $Grpc$;
+   using Stub    = Grpc::Stub;
+   using Service = $RawService$;
+)");
+   print_client(printer, service);
+   print_server(printer, service);
+   printer.Print(R"(};
+)");
+}
+
+class SgrpcGenerator final : public pb::compiler::CodeGenerator
+{
+ public:
+   uint64_t GetSupportedFeatures() const override { return FEATURE_PROTO3_OPTIONAL; }
+
+   bool Generate(const pb::FileDescriptor* file,
+                 const std::string& /* parameter */,
+                 pb::compiler::GeneratorContext* context,
+                 std::string* error) const override
+   {
+      if(file->service_count() == 0) return true; // Nothing to generate, like grpc_cpp_plugin
+      for(int i = 0; i < file->service_count(); ++i)
+         if(!check_method_names(*file->service(i), error)) return false;
+
+      const auto basename = strip_proto(file->name());
+      std::unique_ptr<pb::io::ZeroCopyOutputStream> output{
+          context->Open(basename + ".sgrpc.pb.h")};
+      pb::io::Printer printer{output.get(), '$'};
+
+      printer.Print(Variables{{"source", file->name()}, {"basename", basename}}, R"(
+// Generated by protoc-gen-sgrpc. DO NOT EDIT!
+// source: $source$
+
+#pragma once
+
+#include "$basename$.grpc.pb.h"
+
+#include "sgrpc/sgrpc.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+)");
+
+      const auto ns = file->package().empty() ? std::string{}
+                                              : replace_all(file->package(), ".", "::");
+      if(!ns.empty()) printer.Print(Variables{{"ns", ns}}, "\nnamespace $ns$\n{\n");
+      for(int i = 0; i < file->service_count(); ++i) print_service(printer, *file->service(i));
+      if(!ns.empty()) printer.Print(Variables{{"ns", ns}}, "\n} // namespace $ns$\n");
+      return true;
+   }
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+   SgrpcGenerator generator;
+   return pb::compiler::PluginMain(argc, argv, &generator);
+}